@@ -9,6 +9,7 @@
 #ifdef OINK_MSVC_64
     #include <intrin.h>
     #pragma intrinsic(_BitScanForward64)
+    #pragma intrinsic(__popcnt64)
 #endif
 
 namespace chess 
@@ -39,6 +40,18 @@ namespace chess
         *square = get_first_occ_square(b);
         return b & (b - 1);
     }
+
+    OINK_INLINE int count_bits(Bitboard b)
+    {
+#ifdef OINK_MSVC_64
+        return (int)__popcnt64(b);
+#else
+        int count = 0;
+        for (; b; b &= b - 1)
+            ++count;
+        return count;
+#endif
+    }
 	
     OINK_INLINE Side swap_side(Side side)
     {
@@ -133,6 +146,142 @@ namespace chess
         Bitboard a1h8_diag_occ = b & moves::sixbit_diag_masks_a1h8[diagonal_idx];
         return (a1h8_diag_occ * moves::DIAG_A1H8_ROTATORS[diagonal_idx]) >> 57;
     }
+
+    // Slider attacks from a square for an arbitrary occupancy, i.e. the rotated-occupancy table lookups
+    // used by movegen, wrapped up so that callers which only want the attack set needn't do the projection.
+    OINK_INLINE Bitboard rank_attacks(Square square, Bitboard occupancy)
+    {
+        return moves::horiz_slider_moves[square][get_6bit_rank_occupancy(occupancy, square_to_rank(square))];
+    }
+
+    OINK_INLINE Bitboard file_attacks(Square square, Bitboard occupancy)
+    {
+        return moves::vert_slider_moves[square][project_occupancy_from_file_to6bit(occupancy, square % 8)];
+    }
+
+    OINK_INLINE Bitboard a1h8_attacks(Square square, Bitboard occupancy)
+    {
+        RankFile rank, file;
+        square_to_rank_file(square, rank, file);
+        return moves::diag_moves_a1h8[square][project_occupancy_from_a1h8_to6bit(occupancy, rank, file)];
+    }
+
+    OINK_INLINE Bitboard a8h1_attacks(Square square, Bitboard occupancy)
+    {
+        RankFile rank, file;
+        square_to_rank_file(square, rank, file);
+        return moves::diag_moves_a8h1[square][project_occupancy_from_a8h1_to6bit(occupancy, rank, file)];
+    }
+
+    OINK_INLINE Bitboard rank_file_attacks(Square square, Bitboard occupancy)
+    {
+        return rank_attacks(square, occupancy) | file_attacks(square, occupancy);
+    }
+
+    OINK_INLINE Bitboard diagonal_attacks(Square square, Bitboard occupancy)
+    {
+        return a1h8_attacks(square, occupancy) | a8h1_attacks(square, occupancy);
+    }
+
+    // Board geometry, from the tables in ChessConstants.hpp.
+    OINK_INLINE Bitboard ray(Square square, geometry::Direction direction)
+    {
+        return geometry::rays[direction][square];
+    }
+
+    // Empty unless the squares share a rank, file or diagonal.
+    OINK_INLINE Bitboard between(Square a, Square b)
+    {
+        return geometry::between_squares[a][b];
+    }
+
+    OINK_INLINE Bitboard line_through(Square a, Square b)
+    {
+        return geometry::lines[a][b];
+    }
+
+    // Whether c is on the line through a and b.
+    OINK_INLINE bool aligned(Square a, Square b, Square c)
+    {
+        return (geometry::lines[a][b] >> c) & 1;
+    }
+
+    OINK_INLINE int distance(Square a, Square b)
+    {
+        return geometry::distances[a][b];
+    }
+
+    // Set-wise operations, mostly for pawns: these work on every bit of the board at once.
+    // East is towards the h-file; bits shifted off the edge of the board don't wrap round onto the next rank.
+    OINK_INLINE Bitboard shift_east(Bitboard b)
+    {
+        return (b << 1) & ~util::FILE_A;
+    }
+
+    OINK_INLINE Bitboard shift_west(Bitboard b)
+    {
+        return (b >> 1) & ~util::FILE_H;
+    }
+
+    OINK_INLINE Bitboard shift_forward(Bitboard b, Side side)
+    {
+        return side == sides::white ? b << 8 : b >> 8;
+    }
+
+    // Smear every bit up (towards the eighth rank) or down the board.
+    OINK_INLINE Bitboard fill_north(Bitboard b)
+    {
+        b |= b << 8;
+        b |= b << 16;
+        b |= b << 32;
+        return b;
+    }
+
+    OINK_INLINE Bitboard fill_south(Bitboard b)
+    {
+        b |= b >> 8;
+        b |= b >> 16;
+        b |= b >> 32;
+        return b;
+    }
+
+    OINK_INLINE Bitboard fill_files(Bitboard b)
+    {
+        return fill_north(b) | fill_south(b);
+    }
+
+    // The squares in front of each of the given pieces, from the given side's point of view, not including their own squares.
+    OINK_INLINE Bitboard front_span(Bitboard b, Side side)
+    {
+        return side == sides::white ? fill_north(b << 8) : fill_south(b >> 8);
+    }
+
+    OINK_INLINE Bitboard all_pawn_attacks(Bitboard pawns, Side side)
+    {
+        Bitboard ahead = shift_forward(pawns, side);
+        return shift_east(ahead) | shift_west(ahead);
+    }
+
+    OINK_INLINE Bitboard all_knight_attacks(Bitboard knights)
+    {
+        Bitboard one_across = shift_east(knights) | shift_west(knights);
+        Bitboard two_across = shift_east(shift_east(knights)) | shift_west(shift_west(knights));
+        return (one_across << 16) | (one_across >> 16) | (two_across << 8) | (two_across >> 8);
+    }
+
+    OINK_INLINE Bitboard all_king_attacks(Bitboard kings)
+    {
+        Bitboard across = shift_east(kings) | shift_west(kings);
+        Bitboard row    = kings | across;
+        return across | (row << 8) | (row >> 8);
+    }
+
+    // Every square the pawns could attack, now or after advancing.
+    OINK_INLINE Bitboard pawn_attack_span(Bitboard pawns, Side side)
+    {
+        Bitboard span = front_span(pawns, side);
+        return shift_east(span) | shift_west(span);
+    }
 }
 
 #endif // BASICOPERATIONS_HPP
@@ -16,6 +16,7 @@
 namespace chess
 {
 	typedef uint64_t      Bitboard;
+    typedef uint64_t      HashKey;
 
 #ifdef OINK_USE_NARROWEST_TYPES
     typedef unsigned char Piece;
@@ -34,6 +35,25 @@ namespace chess
 
     typedef int PosEvaluation;
     typedef double PosEvaluationFrac;
+
+    // A middlegame and an endgame value packed into one int, endgame in the high half, so that a pair can be
+    // accumulated with a single add. The low half is signed, so unpacking the high half must allow for the borrow.
+    typedef int32_t Score;
+
+    constexpr Score make_score(PosEvaluation mg, PosEvaluation eg)
+    {
+        return (Score)((uint32_t)eg << 16) + mg;
+    }
+
+    constexpr PosEvaluation mg_value(Score score)
+    {
+        return (int16_t)(uint16_t)(uint32_t)score;
+    }
+
+    constexpr PosEvaluation eg_value(Score score)
+    {
+        return (int16_t)(uint16_t)((uint32_t)(score + 0x8000) >> 16);
+    }
 }
 
 #endif // BASICTYPES_HPP
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "ChessConstants.hpp"
 #include "BasicOperations.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <random>
 
 namespace chess
 {
@@ -13,6 +17,20 @@ namespace chess
 		char symbols[15];
 	}
 
+    namespace evals
+    {
+        Score piece_square[13][util::NUM_SQUARES];
+    }
+
+    namespace zobrist
+    {
+        HashKey piece_square[13][util::NUM_SQUARES];
+        HashKey pawn_square[13][util::NUM_SQUARES];
+        HashKey castling[16];
+        HashKey en_passant[util::NUM_SQUARES + 1];
+        HashKey black_to_move;
+    }
+
     namespace moves
     {
         Bitboard horiz_slider_moves[util::NUM_SQUARES][util::FULL_6BITOCC + 1];
@@ -26,6 +44,14 @@ namespace chess
         Bitboard sixbit_diag_masks_a8h1[NUM_DIAGS];
     }
 
+    namespace geometry
+    {
+        Bitboard      rays[NUM_DIRECTIONS][util::NUM_SQUARES];
+        Bitboard      between_squares[util::NUM_SQUARES][util::NUM_SQUARES];
+        Bitboard      lines[util::NUM_SQUARES][util::NUM_SQUARES];
+        unsigned char distances[util::NUM_SQUARES][util::NUM_SQUARES];
+    }
+
     const int A1H8_SELECT  = 0;
     const int A8H1_SELECT  = 1;
     const int RANK_SELECT  = 0;
@@ -48,6 +74,57 @@ namespace chess
 		pieces::symbols[pieces::BLACK_QUEEN]  = 'q';
     }
 
+    static void init_piece_square_table(Piece white_piece, const PosEvaluation mg_table[], const PosEvaluation eg_table[])
+    {
+        Piece black_piece = white_piece + 1;
+
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+        {
+            // White's view is flipped vertically into a1-first order; black's is then the mirror of white's.
+            evals::piece_square[white_piece][square]      = make_score( mg_table[square ^ 56],  eg_table[square ^ 56]);
+            evals::piece_square[black_piece][square ^ 56] = make_score(-mg_table[square ^ 56], -eg_table[square ^ 56]);
+        }
+    }
+
+    static void init_piece_square_tables()
+    {
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            evals::piece_square[pieces::NONE][square] = 0;
+
+        init_piece_square_table(pieces::WHITE_PAWN,   pst::pawn_mg,   pst::pawn_eg);
+        init_piece_square_table(pieces::WHITE_KNIGHT, pst::knight_mg, pst::knight_eg);
+        init_piece_square_table(pieces::WHITE_BISHOP, pst::bishop_mg, pst::bishop_eg);
+        init_piece_square_table(pieces::WHITE_ROOK,   pst::rook_mg,   pst::rook_eg);
+        init_piece_square_table(pieces::WHITE_QUEEN,  pst::queen_mg,  pst::queen_eg);
+        init_piece_square_table(pieces::WHITE_KING,   pst::king_mg,   pst::king_eg);
+    }
+
+    static void init_zobrist_keys()
+    {
+        // Fixed seed, so that keys (and so hash table behaviour) are the same from run to run.
+        std::mt19937_64 rand_engine(0x6f696e6b);
+
+        for (Piece piece = pieces::NONE; piece <= pieces::BLACK_QUEEN; ++piece)
+        {
+            for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            {
+                bool is_pawn = piece == pieces::WHITE_PAWN || piece == pieces::BLACK_PAWN;
+
+                zobrist::piece_square[piece][square] = piece == pieces::NONE ? 0 : rand_engine();
+                zobrist::pawn_square[piece][square]  = is_pawn ? zobrist::piece_square[piece][square] : 0;
+            }
+        }
+
+        for (int rights = 0; rights < 16; ++rights)
+            zobrist::castling[rights] = rights ? rand_engine() : 0;
+
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            zobrist::en_passant[square] = rand_engine();
+        zobrist::en_passant[squares::NO_SQUARE] = 0;
+
+        zobrist::black_to_move = rand_engine();
+    }
+
 	static void generate_rank_file_masks()
 	{
 		for (RankFile i = 0; i < util::BOARD_SIZE; ++i)  //rank or file loop
@@ -418,14 +495,72 @@ namespace chess
         assert(diag_length[A8H1_SELECT] >= 0 && diag_length[A8H1_SELECT] <= util::BOARD_SIZE);
 	}
 
+    static void generate_geometry()
+    {
+        using namespace geometry;
+
+        // Indexed by Direction.
+        const RankFile rank_steps[NUM_DIRECTIONS] = { 1, 1, 0, -1, -1, -1,  0,  1 };
+        const RankFile file_steps[NUM_DIRECTIONS] = { 0, 1, 1,  1,  0, -1, -1, -1 };
+
+        memset(between_squares, 0, sizeof(between_squares));
+        memset(lines,           0, sizeof(lines));
+
+        for (Square from = 0; from < util::NUM_SQUARES; ++from)
+        {
+            RankFile from_rank, from_file;
+            square_to_rank_file(from, from_rank, from_file);
+
+            for (int direction = 0; direction < NUM_DIRECTIONS; ++direction)
+            {
+                rays[direction][from] = util::nil;
+                RankFile rank = from_rank + rank_steps[direction], file = from_file + file_steps[direction];
+                for (; rank >= 0 && rank < util::BOARD_SIZE && file >= 0 && file < util::BOARD_SIZE; rank += rank_steps[direction], file += file_steps[direction])
+                {
+                    Square to = rank_file_to_square(rank, file);
+                    between_squares[from][to] = rays[direction][from];
+                    rays[direction][from] |= util::one << to;
+                }
+            }
+
+            for (Square to = 0; to < util::NUM_SQUARES; ++to)
+            {
+                RankFile to_rank, to_file;
+                square_to_rank_file(to, to_rank, to_file);
+                distances[from][to] = (unsigned char)std::max(std::abs(to_rank - from_rank), std::abs(to_file - from_file));
+            }
+        }
+
+        // Each line is a ray and its opposite, from either square; the opposite direction is always four on.
+        for (Square from = 0; from < util::NUM_SQUARES; ++from)
+        {
+            for (int direction = 0; direction < NUM_DIRECTIONS; ++direction)
+            {
+                Bitboard line = rays[direction][from] | rays[(direction + 4) % NUM_DIRECTIONS][from] | (util::one << from);
+                for (Bitboard b = rays[direction][from]; b; )
+                {
+                    Square to;
+                    b = get_and_clear_first_occ_square(b, &to);
+                    lines[from][to] = line;
+                }
+            }
+        }
+    }
+
     void constants_initialize()
     {
         init_piece_symbols();
 
+        init_piece_square_tables();
+
+        init_zobrist_keys();
+
         generate_rank_file_masks();
 
         generate_diag_masks();
 
+        generate_geometry();
+
         //===================== Generate moves=======================
         for (int i = 0; i < util::NUM_SQUARES; ++i) //loop over all squares
 		{ 
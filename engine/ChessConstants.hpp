@@ -2,6 +2,7 @@
 #define CHESSCONSTANTS_HPP
 
 #include "BasicTypes.hpp"
+#include "EvalWeights.hpp"
 
 #include <climits>
 
@@ -33,6 +34,8 @@ namespace chess
         const Bitboard fullrank        = 0x00000000000000ff;
         const Bitboard FULL_6BITOCC    = 0x000000000000003f;
         const Bitboard OCC_8_TO_6_MASK = 0x000000000000007e;
+        const Bitboard FILE_A          = 0x0101010101010101;
+        const Bitboard FILE_H          = 0x8080808080808080;
         const Square   NUM_SQUARES  = 64;
         const RankFile BOARD_SIZE   = 8;
 
@@ -102,19 +105,109 @@ namespace chess
         const PosEvaluation INITIAL_SEARCH_VALUE = INT_MIN;
         const PosEvaluation MATE_SCORE = 1000000;
         const PosEvaluation DRAW_SCORE = 0;
-        const PosEvaluation PAWN_CAPTURE_VALUES[2] = { -100, +100 };
+        const PosEvaluation PAWN_CAPTURE_VALUES[2] = { -PAWN_VALUE, +PAWN_VALUE };
         const PosEvaluation PIECE_CAPTURE_VALUES[]
         {
             0, 
-            -100, +100,
+            -PAWN_VALUE, +PAWN_VALUE,
             -MATE_SCORE, +MATE_SCORE, // King
-            -500, 500,
-            -300, 300,
-            -300, 300,
-            -900, 900,
+            -ROOK_VALUE, +ROOK_VALUE,
+            -KNIGHT_VALUE, +KNIGHT_VALUE,
+            -BISHOP_VALUE, +BISHOP_VALUE,
+            -QUEEN_VALUE, +QUEEN_VALUE,
         };
 
         const PosEvaluation CHECK_BIAS = 50;
+
+        // Game phase: the non-pawn material on the board, weighted, which is TOTAL_PHASE in the starting position
+        // and zero with just kings and pawns. Used to blend middlegame and endgame scores.
+        const int PHASE_WEIGHTS[] =
+        {
+            0,
+            0, 0, // Pawns
+            0, 0, // Kings
+            2, 2, // Rooks
+            1, 1, // Knights
+            1, 1, // Bishops
+            4, 4, // Queens
+        };
+        const int TOTAL_PHASE = 24;
+
+        // Middlegame/endgame piece-square tables, indexed [piece][square]. Filled in by constants_initialize(), from the
+        // tables in EvalWeights.hpp.
+        // Signed the same way as Position::material, i.e. positive is good for white.
+        extern Score piece_square[13][util::NUM_SQUARES];  // 3.3k
+
+        // The weights below, and the piece values, live in EvalWeights.hpp, which is written by the tuner (tuner/OinkTuner.cpp).
+        // They're (middlegame, endgame) pairs, from the point of view of the side they apply to.
+        //
+        // Pawn structure, per pawn: PASSED_PAWN_BONUS and CANDIDATE_PASSER_BONUS, indexed by rank from the pawn's side's point of
+        // view; ISOLATED_PAWN_PENALTY, DOUBLED_PAWN_PENALTY and BACKWARD_PAWN_PENALTY. UNBLOCKED_PASSER_BONUS is for passed pawns
+        // with nothing at all in the way, which depends on the pieces, so it isn't part of the cached pawn score.
+        // PAWN_SHIELD_BONUS is for own pawns one and two ranks in front of the king, on its file or the adjacent ones.
+        //
+        // Threats, to pieces other than pawns and kings: HANGING_PIECE_PENALTY for those attacked and not defended at all,
+        // THREAT_BY_PAWN_PENALTY for those attacked by pawns, and THREAT_BY_MINOR_PENALTY for rooks and queens attacked by minors.
+        //
+        // MOBILITY_WEIGHTS, per piece: squares attacked that aren't occupied by our own pieces or attacked by enemy pawns, counted
+        // relative to a typical number for the piece, so that the term is around zero on average.
+        const int MOBILITY_BASELINE[] = { 0, 0, 0, 0, 0, 7, 7, 4, 4, 7, 7, 14, 14 };
+
+        // King safety: each piece attacking squares next to the enemy king adds its weight per square attacked. With at least
+        // two attackers, the king is penalised by the square of the total (over KING_DANGER_DIVISOR), in the middlegame only.
+        const int KING_ATTACK_WEIGHTS[] = { 0, 0, 0, 0, 0, 3, 3, 2, 2, 2, 2, 5, 5 };
+        const int KING_DANGER_DIVISOR   = 4;
+        const int KING_DANGER_MAX       = 500;
+
+        // Material imbalance, from the numbers of pieces alone: BISHOP_PAIR_BONUS for having both bishops, and each knight gaining
+        // (each rook losing) KNIGHT_PAWN_ADJUSTMENT (ROOK_PAWN_ADJUSTMENT) for each of its side's pawns over five.
+        const Score BISHOP_PAIR_BONUS      = make_score(30, 50);
+        const Score KNIGHT_PAWN_ADJUSTMENT = make_score(6, 6);
+        const Score ROOK_PAWN_ADJUSTMENT   = make_score(-12, -12);
+
+        // Lazy evaluation: how far the rest of the evaluation can move the score after material and piece-square values, and after
+        // the pawn terms as well. A little above the 99th percentile of the difference over a set of self-play positions (200 and
+        // 127 over 262k of them), as reported by the test harness's lazy_margins command.
+        const PosEvaluation LAZY_MARGIN_MATERIAL = 220;
+        const PosEvaluation LAZY_MARGIN_PAWNS    = 140;
+
+        // What the specialised endgame evaluations add for a position that's won, but not yet as a forced mate in the search.
+        const PosEvaluation KNOWN_WIN = 10000;
+    }
+
+    // Material signature (Position::material_key): the number of pieces of each kind, four bits each, at bit (4 * piece).
+    // Kings aren't counted, so their bits are always clear. Positions with the same material have the same key and no others do,
+    // so it can be added to and subtracted from as pieces come and go, and decoded with material_keys::count().
+    namespace material_keys
+    {
+        const HashKey UNITS[13] =
+        {
+            0,
+            0x10ull, 0x100ull,                     // Pawns
+            0, 0,                                  // Kings
+            0x100000ull, 0x1000000ull,             // Rooks
+            0x10000000ull, 0x100000000ull,         // Knights
+            0x1000000000ull, 0x10000000000ull,     // Bishops
+            0x100000000000ull, 0x1000000000000ull, // Queens
+        };
+
+        OINK_INLINE int count(HashKey key, Piece piece)
+        {
+            return (int)(key >> (4 * piece)) & 0xf;
+        }
+    }
+
+    // Random keys for hashing positions, indexed [piece][square]. Filled in by constants_initialize().
+    namespace zobrist
+    {
+        extern HashKey piece_square[13][util::NUM_SQUARES];  // 6.5k
+        // As piece_square, but zero for everything except pawns, so that the pawn key can be kept up to date
+        // without having to branch on the type of piece moved or captured.
+        extern HashKey pawn_square[13][util::NUM_SQUARES];   // 6.5k
+        extern HashKey castling[16];                         // Indexed by the castling rights bitmask
+        extern HashKey en_passant[util::NUM_SQUARES + 1];    // Indexed by the EP target square; zero for NO_SQUARE
+        // Not part of Position::hash_key, as the side to move isn't part of the Position; XORed in by anything that needs it.
+        extern HashKey black_to_move;
     }
 
 	namespace squares
@@ -213,6 +306,20 @@ namespace chess
         const unsigned char CASTLING_RIGHTS_ANY_WHITE = CASTLING_RIGHTS_WHITE_KINGSIDE | CASTLING_RIGHTS_WHITE_QUEENSIDE;
         const unsigned char CASTLING_RIGHTS_ANY_BLACK = CASTLING_RIGHTS_BLACK_KINGSIDE | CASTLING_RIGHTS_BLACK_QUEENSIDE;
         const unsigned char CASTLING_RIGHTS_ANY[2]    = { CASTLING_RIGHTS_ANY_WHITE, CASTLING_RIGHTS_ANY_BLACK };
+
+        // [square] The castling rights that survive a move from or to it: anything touching a king or rook on its starting square
+        // means it has moved, or been taken.
+        const unsigned char CASTLING_RIGHTS_KEPT[util::NUM_SQUARES] =
+        {
+            0xd, 0xf, 0xf, 0xf, 0xc, 0xf, 0xf, 0xe, // a1 .. h1
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf, 0xf,
+            0x7, 0xf, 0xf, 0xf, 0x3, 0xf, 0xf, 0xb, // a8 .. h8
+        };
     }
 
     namespace squarebits
@@ -305,6 +412,19 @@ namespace chess
         const unsigned char CASTLING_BLACK_KINGSIDE  = 3;
         const unsigned char CASTLING_BLACK_QUEENSIDE = 4;
 
+        // For a move's type field: which of make_move's handlers it needs.
+        const unsigned char MOVE_NORMAL     = 0;
+        const unsigned char MOVE_CAPTURE    = 1;
+        const unsigned char MOVE_PROMOTION  = 2; // Capturing or not
+        const unsigned char MOVE_EN_PASSANT = 3;
+        const unsigned char MOVE_CASTLING   = 4;
+
+        // For a Move16's special field. Unlike the above, captures aren't told apart.
+        const unsigned char MOVE16_NORMAL     = 0;
+        const unsigned char MOVE16_PROMOTION  = 1;
+        const unsigned char MOVE16_EN_PASSANT = 2;
+        const unsigned char MOVE16_CASTLING   = 3;
+
         // 512 bytes
         const Bitboard king_moves[util::NUM_SQUARES] = 
         {
@@ -740,7 +860,64 @@ namespace chess
         const Bitboard white_queenside_castling_mask = 0x000000000000000e;
         const Bitboard black_kingside_castling_mask  = 0x6000000000000000;
         const Bitboard black_queenside_castling_mask = 0x0e00000000000000;
+
+        // The squares the king castles from and through, which mustn't be attacked. Where it lands is checked as for any other move.
+        const Bitboard white_kingside_king_path  = 0x0000000000000030;
+        const Bitboard white_queenside_king_path = 0x0000000000000018;
+        const Bitboard black_kingside_king_path  = 0x3000000000000000;
+        const Bitboard black_queenside_king_path = 0x1800000000000000;
     }
+
+    // Lines on the board, filled in by constants_initialize(). See BasicOperations.hpp for the functions that look them up.
+    namespace geometry
+    {
+        enum Direction { NORTH, NORTH_EAST, EAST, SOUTH_EAST, SOUTH, SOUTH_WEST, WEST, NORTH_WEST, NUM_DIRECTIONS };
+
+        extern Bitboard      rays[NUM_DIRECTIONS][util::NUM_SQUARES];           // 4k:  From a square to the edge of the board, not including the square
+        extern Bitboard      between_squares[util::NUM_SQUARES][util::NUM_SQUARES]; // 32k: Strictly between two squares on a rank, file or diagonal, otherwise empty
+        extern Bitboard      lines[util::NUM_SQUARES][util::NUM_SQUARES];       // 32k: The whole rank, file or diagonal through two squares, otherwise empty
+        extern unsigned char distances[util::NUM_SQUARES][util::NUM_SQUARES];   // 4k:  King moves from one square to another
+    }
+
+    // Compile-time counterparts of the per-side constants above, for code templated on the side to move (move generation,
+    // make_move, perft and the search), so that it needn't index tables by side or branch on it.
+    template<Side Us>
+    struct SideConstants
+    {
+        static constexpr Side them    = Us == sides::white ? sides::black : sides::white;
+        static constexpr int  forward = Us == sides::white ? util::BOARD_SIZE : -util::BOARD_SIZE; // To the square in front
+
+        // A black piece is always one on from the white one.
+        static constexpr Piece pawn   = Piece(pieces::WHITE_PAWN   + Us);
+        static constexpr Piece king   = Piece(pieces::WHITE_KING   + Us);
+        static constexpr Piece rook   = Piece(pieces::WHITE_ROOK   + Us);
+        static constexpr Piece knight = Piece(pieces::WHITE_KNIGHT + Us);
+        static constexpr Piece bishop = Piece(pieces::WHITE_BISHOP + Us);
+        static constexpr Piece queen  = Piece(pieces::WHITE_QUEEN  + Us);
+
+        // Where single pushes can go on to push again, and where pawns promote.
+        static constexpr Bitboard third_rank = Us == sides::white ? 0x0000000000ff0000 : 0x0000ff0000000000;
+        static constexpr Bitboard last_rank  = Us == sides::white ? 0xff00000000000000 : 0x00000000000000ff;
+
+        static constexpr Square        king_start         = Us == sides::white ? squares::e1 : squares::e8;
+        static constexpr unsigned char any_castling_rights = Us == sides::white ? sides::CASTLING_RIGHTS_ANY_WHITE : sides::CASTLING_RIGHTS_ANY_BLACK;
+
+        static constexpr unsigned char kingside_castling   = Us == sides::white ? moves::CASTLING_WHITE_KINGSIDE : moves::CASTLING_BLACK_KINGSIDE;
+        static constexpr unsigned char kingside_rights     = Us == sides::white ? sides::CASTLING_RIGHTS_WHITE_KINGSIDE : sides::CASTLING_RIGHTS_BLACK_KINGSIDE;
+        static constexpr Bitboard      kingside_empty      = Us == sides::white ? moves::white_kingside_castling_mask : moves::black_kingside_castling_mask;
+        static constexpr Bitboard      kingside_king_path  = Us == sides::white ? moves::white_kingside_king_path : moves::black_kingside_king_path;
+        static constexpr Square        kingside_king_to    = Us == sides::white ? squares::g1 : squares::g8;
+        static constexpr Square        kingside_rook_from  = Us == sides::white ? squares::h1 : squares::h8;
+        static constexpr Square        kingside_rook_to    = Us == sides::white ? squares::f1 : squares::f8;
+
+        static constexpr unsigned char queenside_castling  = Us == sides::white ? moves::CASTLING_WHITE_QUEENSIDE : moves::CASTLING_BLACK_QUEENSIDE;
+        static constexpr unsigned char queenside_rights    = Us == sides::white ? sides::CASTLING_RIGHTS_WHITE_QUEENSIDE : sides::CASTLING_RIGHTS_BLACK_QUEENSIDE;
+        static constexpr Bitboard      queenside_empty     = Us == sides::white ? moves::white_queenside_castling_mask : moves::black_queenside_castling_mask;
+        static constexpr Bitboard      queenside_king_path = Us == sides::white ? moves::white_queenside_king_path : moves::black_queenside_king_path;
+        static constexpr Square        queenside_king_to   = Us == sides::white ? squares::c1 : squares::c8;
+        static constexpr Square        queenside_rook_from = Us == sides::white ? squares::a1 : squares::a8;
+        static constexpr Square        queenside_rook_to   = Us == sides::white ? squares::d1 : squares::d8;
+    };
 }
 
 #endif // CHESSCONSTANTS_HPP
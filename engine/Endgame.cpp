@@ -0,0 +1,351 @@
+#include "Endgame.hpp"
+#include "Position.hpp"
+#include "BasicOperations.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+namespace chess
+{
+    static const Bitboard DARK_SQUARES = 0xaa55aa55aa55aa55;
+
+    static OINK_INLINE bool is_dark(Square square)
+    {
+        return (DARK_SQUARES >> square) & 1;
+    }
+
+    // Bonuses for the weak king being near the edge, and the kings being close together, which are what it takes to mate.
+    static OINK_INLINE PosEvaluation push_to_edge(Square square)
+    {
+        RankFile rank = square_to_rank(square), file = square & 7;
+        return 20 * ((rank < 4 ? 3 - rank : rank - 4) + (file < 4 ? 3 - file : file - 4));
+    }
+
+    static OINK_INLINE PosEvaluation push_close(Square a, Square b)
+    {
+        return 20 * (7 - distance(a, b));
+    }
+
+    static OINK_INLINE PosEvaluation side_material(const Position &pos, Side side)
+    {
+        return side == sides::white ? pos.material : -pos.material;
+    }
+
+    //===================== King and pawn against king =======================
+
+    // Every position with white to move or black to move, white's pawn on files a-d (the others are mirror images) and ranks 2-7.
+    namespace kpk
+    {
+        const int NUM_POSITIONS = 2 * 64 * 64 * 24;
+
+        enum Result : unsigned char
+        {
+            INVALID = 0,
+            UNKNOWN = 1,
+            DRAW    = 2,
+            WIN     = 4
+        };
+
+        static OINK_INLINE int index(bool white_to_move, Square white_king, Square black_king, Square pawn)
+        {
+            int pawn_index = (square_to_rank(pawn) - 1) * 4 + (pawn & 7);
+            return ((white_to_move * 64 + white_king) * 64 + black_king) * 24 + pawn_index;
+        }
+
+        static Result initial_result(bool white_to_move, Square white_king, Square black_king, Square pawn)
+        {
+            if (distance(white_king, black_king) <= 1 || white_king == pawn || black_king == pawn ||
+                (white_to_move && (moves::pawn_captures[sides::white][pawn] & squarebits::indexed[black_king])))
+                return INVALID;
+
+            const Square queening = pawn + 8;
+            if (white_to_move)
+            {
+                // Promotes safely.
+                if (square_to_rank(pawn) == ranks::seventh && white_king != queening && black_king != queening &&
+                    (distance(black_king, queening) > 1 || distance(white_king, queening) == 1))
+                    return WIN;
+            }
+            else
+            {
+                Bitboard guarded = moves::king_moves[white_king] | moves::pawn_captures[sides::white][pawn];
+
+                // Stalemate, or the pawn can be taken.
+                if (!(moves::king_moves[black_king] & ~guarded) ||
+                    (moves::king_moves[black_king] & squarebits::indexed[pawn] & ~moves::king_moves[white_king]))
+                    return DRAW;
+            }
+
+            return UNKNOWN;
+        }
+
+        // The best of the results of the moves, from the point of view of the side to move.
+        static Result classify(const Result db[], bool white_to_move, Square white_king, Square black_king, Square pawn)
+        {
+            int results = 0;
+            Square square;
+
+            if (white_to_move)
+            {
+                for (Bitboard b = moves::king_moves[white_king]; b; )
+                {
+                    b = get_and_clear_first_occ_square(b, &square);
+                    results |= db[index(false, square, black_king, pawn)];
+                }
+
+                if (square_to_rank(pawn) < ranks::seventh)
+                    results |= db[index(false, white_king, black_king, pawn + 8)];
+                if (square_to_rank(pawn) == ranks::second && pawn + 8 != white_king && pawn + 8 != black_king)
+                    results |= db[index(false, white_king, black_king, pawn + 16)];
+
+                return results & WIN ? WIN : results & UNKNOWN ? UNKNOWN : DRAW;
+            }
+
+            for (Bitboard b = moves::king_moves[black_king]; b; )
+            {
+                b = get_and_clear_first_occ_square(b, &square);
+                results |= db[index(true, white_king, square, pawn)];
+            }
+
+            return results & DRAW ? DRAW : results & UNKNOWN ? UNKNOWN : WIN;
+        }
+
+        struct Bitbase
+        {
+            uint32_t wins[NUM_POSITIONS / 32];
+
+            Bitbase()
+            {
+                std::vector<Result> db(NUM_POSITIONS);
+
+                for (int stm = 0; stm < 2; ++stm)
+                    for (Square white_king = 0; white_king < util::NUM_SQUARES; ++white_king)
+                        for (Square black_king = 0; black_king < util::NUM_SQUARES; ++black_king)
+                            for (int pawn_index = 0; pawn_index < 24; ++pawn_index)
+                            {
+                                Square pawn = rank_file_to_square(pawn_index / 4 + 1, pawn_index % 4);
+                                db[index(stm != 0, white_king, black_king, pawn)] = initial_result(stm != 0, white_king, black_king, pawn);
+                            }
+
+                // Keep going until nothing more can be decided: whatever's left is a draw.
+                bool changed = true;
+                while (changed)
+                {
+                    changed = false;
+                    for (int stm = 0; stm < 2; ++stm)
+                        for (Square white_king = 0; white_king < util::NUM_SQUARES; ++white_king)
+                            for (Square black_king = 0; black_king < util::NUM_SQUARES; ++black_king)
+                                for (int pawn_index = 0; pawn_index < 24; ++pawn_index)
+                                {
+                                    Square pawn = rank_file_to_square(pawn_index / 4 + 1, pawn_index % 4);
+                                    Result &result = db[index(stm != 0, white_king, black_king, pawn)];
+                                    if (result == UNKNOWN)
+                                    {
+                                        result  = classify(db.data(), stm != 0, white_king, black_king, pawn);
+                                        changed = changed || result != UNKNOWN;
+                                    }
+                                }
+                }
+
+                std::fill(wins, wins + NUM_POSITIONS / 32, 0);
+                for (int i = 0; i < NUM_POSITIONS; ++i)
+                    if (db[i] == WIN)
+                        wins[i / 32] |= 1u << (i % 32);
+            }
+        };
+    }
+
+    bool kpk_is_win(Square strong_king, Square pawn, Square weak_king, bool strong_to_move)
+    {
+        // 24k, worked out the first time it's needed.
+        static const kpk::Bitbase bitbase;
+
+        // Mirror the pawn onto files a-d.
+        if ((pawn & 7) > files::d)
+        {
+            strong_king ^= 7;
+            weak_king   ^= 7;
+            pawn        ^= 7;
+        }
+
+        int i = kpk::index(strong_to_move, strong_king, weak_king, pawn);
+        return (bitbase.wins[i / 32] >> (i % 32)) & 1;
+    }
+
+    //===================== Specialised evaluations =======================
+
+    // Lone king against enough to mate it: drive it to the edge and close in.
+    static PosEvaluation evaluate_kxk(const Position &pos, Side strong_side, Side)
+    {
+        const Square strong_king = get_first_occ_square(pos.kings[strong_side]);
+        const Square weak_king   = get_first_occ_square(pos.kings[swap_side(strong_side)]);
+
+        Bitboard bishops = pos.bishops[strong_side];
+        bool can_mate = pos.queens[strong_side] || pos.rooks[strong_side] || pos.pawns[strong_side] ||
+                        (bishops && pos.knights[strong_side]) || ((bishops & DARK_SQUARES) && (bishops & ~DARK_SQUARES)) ||
+                        count_bits(pos.knights[strong_side]) >= 3;
+        if (!can_mate)
+            return evals::DRAW_SCORE;
+
+        return evals::KNOWN_WIN + side_material(pos, strong_side) + push_to_edge(weak_king) + push_close(strong_king, weak_king);
+    }
+
+    // Bishop and knight: the mate can only be forced in a corner the bishop covers.
+    static PosEvaluation evaluate_kbnk(const Position &pos, Side strong_side, Side)
+    {
+        const Square strong_king = get_first_occ_square(pos.kings[strong_side]);
+        const Square weak_king   = get_first_occ_square(pos.kings[swap_side(strong_side)]);
+
+        bool dark_bishop = (pos.bishops[strong_side] & DARK_SQUARES) != 0;
+        int  corner_distance = dark_bishop ? std::min(distance(weak_king, squares::a1), distance(weak_king, squares::h8))
+                                           : std::min(distance(weak_king, squares::a8), distance(weak_king, squares::h1));
+
+        return evals::KNOWN_WIN + side_material(pos, strong_side) + 20 * (7 - corner_distance) + push_close(strong_king, weak_king);
+    }
+
+    static PosEvaluation evaluate_kpk(const Position &pos, Side strong_side, Side side_to_move)
+    {
+        // Seen from the strong side, as the bitbase is.
+        const int flip = strong_side == sides::white ? 0 : 56;
+        Square strong_king = get_first_occ_square(pos.kings[strong_side]) ^ flip;
+        Square weak_king   = get_first_occ_square(pos.kings[swap_side(strong_side)]) ^ flip;
+        Square pawn        = get_first_occ_square(pos.pawns[strong_side]) ^ flip;
+
+        if (!kpk_is_win(strong_king, pawn, weak_king, side_to_move == strong_side))
+            return evals::DRAW_SCORE;
+
+        return evals::KNOWN_WIN + evals::PAWN_VALUE + 20 * square_to_rank(pawn);
+    }
+
+    //===================== Scale factors =======================
+
+    // Pawns all on a rook's file, with a bishop that can't cover the queening square: a draw if the defending king gets there first.
+    static int scale_wrong_bishop(const Position &pos, Side strong_side)
+    {
+        const Bitboard pawns = pos.pawns[strong_side];
+        if ((pawns & ~util::FILE_A) && (pawns & ~util::FILE_H))
+            return SCALE_FACTOR_NORMAL;
+
+        RankFile file     = get_first_occ_square(pawns) & 7;
+        Square   queening = rank_file_to_square(strong_side == sides::white ? ranks::eighth : ranks::first, file);
+        Square   weak_king = get_first_occ_square(pos.kings[swap_side(strong_side)]);
+
+        if (is_dark(queening) != ((pos.bishops[strong_side] & DARK_SQUARES) != 0) && distance(weak_king, queening) <= 1)
+            return SCALE_FACTOR_DRAW;
+
+        return SCALE_FACTOR_NORMAL;
+    }
+
+    // Bishops of opposite colours, and nothing else but pawns: the defender can usually blockade on the squares the other bishop
+    // doesn't cover, even a pawn or two down.
+    static int scale_opposite_bishops(const Position &pos, Side strong_side)
+    {
+        const Side weak_side = swap_side(strong_side);
+        if (((pos.bishops[strong_side] & DARK_SQUARES) != 0) == ((pos.bishops[weak_side] & DARK_SQUARES) != 0))
+            return SCALE_FACTOR_NORMAL;
+
+        int extra_pawns = count_bits(pos.pawns[strong_side]) - count_bits(pos.pawns[weak_side]);
+        return extra_pawns <= 1 ? SCALE_FACTOR_NORMAL / 4 : SCALE_FACTOR_NORMAL / 2;
+    }
+
+    //===================== Material analysis =======================
+
+    void select_endgame(const int counts[13], EndgameSelection &selection)
+    {
+        selection.evaluation  = NO_ENDGAME_EVALUATION;
+        selection.strong_side = sides::white;
+        selection.scaling[sides::white] = NO_ENDGAME_SCALING;
+        selection.scaling[sides::black] = NO_ENDGAME_SCALING;
+
+        int pawns[2], knights[2], bishops[2], rooks[2], queens[2];
+        for (Side side = sides::white; side <= sides::black; ++side)
+        {
+            pawns[side]   = counts[pieces::PAWNS[side]];
+            knights[side] = counts[pieces::KNIGHTS[side]];
+            bishops[side] = counts[pieces::BISHOPS[side]];
+            rooks[side]   = counts[pieces::ROOKS[side]];
+            queens[side]  = counts[pieces::QUEENS[side]];
+        }
+
+        for (Side strong = sides::white; strong <= sides::black; ++strong)
+        {
+            const Side weak = swap_side(strong);
+            const int  weak_material = pawns[weak] + knights[weak] + bishops[weak] + rooks[weak] + queens[weak];
+            const int  minors        = knights[strong] + bishops[strong];
+            const bool no_pieces     = !minors && !rooks[strong] && !queens[strong];
+
+            if (!weak_material && (pawns[strong] || !no_pieces))
+            {
+                selection.strong_side = (unsigned char)strong;
+
+                if (no_pieces && pawns[strong] == 1)
+                    selection.evaluation = ENDGAME_KPK;
+                else if (queens[strong] || rooks[strong])
+                    selection.evaluation = ENDGAME_KXK;
+                else if (!pawns[strong] && knights[strong] == 1 && bishops[strong] == 1)
+                    selection.evaluation = ENDGAME_KBNK;
+                else if (!pawns[strong] && (minors == 1 || (knights[strong] == 2 && !bishops[strong])))
+                    selection.evaluation = ENDGAME_DRAW;
+                else if (!pawns[strong] && minors)
+                    selection.evaluation = ENDGAME_KXK;
+            }
+
+            if (bishops[strong] == 1 && !knights[strong] && !rooks[strong] && !queens[strong] && pawns[strong] &&
+                !knights[weak] && !bishops[weak] && !rooks[weak] && !queens[weak])
+                selection.scaling[strong] = SCALING_WRONG_BISHOP;
+        }
+
+        bool only_bishops = true;
+        for (Side side = sides::white; side <= sides::black; ++side)
+            only_bishops = only_bishops && bishops[side] == 1 && !knights[side] && !rooks[side] && !queens[side];
+        if (only_bishops)
+            selection.scaling[sides::white] = selection.scaling[sides::black] = SCALING_OPPOSITE_BISHOPS;
+    }
+
+    PosEvaluation evaluate_endgame(const EndgameSelection &selection, const Position &pos, Side side_to_move)
+    {
+        switch (selection.evaluation)
+        {
+        case ENDGAME_KXK:
+            return evaluate_kxk(pos, selection.strong_side, side_to_move);
+        case ENDGAME_KBNK:
+            return evaluate_kbnk(pos, selection.strong_side, side_to_move);
+        case ENDGAME_KPK:
+            return evaluate_kpk(pos, selection.strong_side, side_to_move);
+        default:
+            return evals::DRAW_SCORE;
+        }
+    }
+
+    int endgame_scale_factor(const EndgameSelection &selection, const Position &pos, Side side_ahead)
+    {
+        switch (selection.scaling[side_ahead])
+        {
+        case SCALING_WRONG_BISHOP:
+            return scale_wrong_bishop(pos, side_ahead);
+        case SCALING_OPPOSITE_BISHOPS:
+            return scale_opposite_bishops(pos, side_ahead);
+        default:
+            return SCALE_FACTOR_NORMAL;
+        }
+    }
+
+    bool has_endgame_knowledge(const Position &pos)
+    {
+        int counts[13];
+        for (Piece piece = 0; piece < 13; ++piece)
+            counts[piece] = material_keys::count(pos.material_key, piece);
+
+        EndgameSelection selection;
+        select_endgame(counts, selection);
+        if (selection.evaluation != NO_ENDGAME_EVALUATION)
+            return true;
+
+        for (Side side = sides::white; side <= sides::black; ++side)
+            if (endgame_scale_factor(selection, pos, side) != SCALE_FACTOR_NORMAL)
+                return true;
+
+        return false;
+    }
+}
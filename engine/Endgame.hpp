@@ -0,0 +1,56 @@
+#ifndef ENDGAME_HPP
+#define ENDGAME_HPP
+
+#include "BasicTypes.hpp"
+#include "ChessConstants.hpp"
+
+namespace chess
+{
+    class Position;
+
+    // Scale factors, applied to the general evaluation when it favours a side that has trouble winning.
+    const int SCALE_FACTOR_DRAW   = 0;
+    const int SCALE_FACTOR_NORMAL = 64;
+
+    // Specialised evaluations, used instead of the general evaluation.
+    enum EndgameEvaluation : unsigned char
+    {
+        NO_ENDGAME_EVALUATION,
+        ENDGAME_KXK,            // Lone king against enough to mate it
+        ENDGAME_KBNK,
+        ENDGAME_KPK,
+        ENDGAME_DRAW,           // Lone king against minor pieces that can't mate
+    };
+
+    enum EndgameScaling : unsigned char
+    {
+        NO_ENDGAME_SCALING,
+        SCALING_WRONG_BISHOP,     // Bishop and rook's pawns, the bishop not covering the queening square
+        SCALING_OPPOSITE_BISHOPS, // Bishops and pawns only, maybe of opposite colours
+    };
+
+    // Which specialised evaluation and scaling, if any, apply to some material.
+    struct EndgameSelection
+    {
+        EndgameEvaluation evaluation;
+        unsigned char     strong_side;   // The side the evaluation is for
+        EndgameScaling    scaling[2];    // [side ahead]
+    };
+
+    // Works out the selection from the numbers of each piece (indexed by piece, as in Position::piece_bbs).
+    void select_endgame(const int counts[13], EndgameSelection &selection);
+
+    // The specialised evaluation, from the point of view of the selection's strong side.
+    PosEvaluation evaluate_endgame(const EndgameSelection &selection, const Position &pos, Side side_to_move);
+    // How much of the general evaluation to keep when it favours the side ahead, out of SCALE_FACTOR_NORMAL.
+    int endgame_scale_factor(const EndgameSelection &selection, const Position &pos, Side side_ahead);
+
+    // Whether the position gets a specialised evaluation, or has its general evaluation scaled, so that its evaluation isn't simply
+    // made of the weights.
+    bool has_endgame_knowledge(const Position &pos);
+
+    // Whether white wins king and pawn against king, with perfect play. The squares are as seen by white, i.e. for the side with the pawn.
+    bool kpk_is_win(Square strong_king, Square pawn, Square weak_king, bool strong_to_move);
+}
+
+#endif // ENDGAME_HPP
@@ -0,0 +1,44 @@
+#include "EvalCache.hpp"
+
+namespace chess
+{
+    EvalCache::EvalCache(size_t bytes) :
+        num_entries(0),
+        index_mask(0),
+        probes(0),
+        hits(0)
+    {
+        resize(bytes);
+    }
+
+    void EvalCache::resize(size_t bytes)
+    {
+        size_t new_num_entries = bytes / sizeof(Entry);
+
+        // Round down to a power of two, so that the index is just a mask of the key.
+        while (new_num_entries & (new_num_entries - 1))
+            new_num_entries &= new_num_entries - 1;
+
+        if (new_num_entries != num_entries)
+        {
+            entries.reset(new_num_entries ? new Entry[new_num_entries] : nullptr);
+            num_entries = new_num_entries;
+            index_mask  = new_num_entries ? new_num_entries - 1 : 0;
+        }
+
+        clear();
+    }
+
+    size_t EvalCache::size_in_bytes() const
+    {
+        return num_entries * sizeof(Entry);
+    }
+
+    void EvalCache::clear()
+    {
+        for (size_t i = 0; i < num_entries; ++i)
+            entries[i].store(0, std::memory_order_relaxed);
+        probes.store(0, std::memory_order_relaxed);
+        hits.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef EVALCACHE_HPP
+#define EVALCACHE_HPP
+
+#include "BasicTypes.hpp"
+
+#include <atomic>
+#include <memory>
+
+namespace chess
+{
+    // Cache of leaf evaluations, keyed by Position::hash_key combined with the side to move.
+    // Each entry is a single 64-bit word, the top half of the key alongside the evaluation, so it's always read and written
+    // whole: no locking is needed for it to be shared, and there's no way to get one position's key with another's evaluation.
+    // The bottom half of the key picks the entry.
+    class EvalCache
+    {
+        typedef std::atomic<uint64_t> Entry;
+
+        // Set in every entry that's been stored to, so that an empty (zero) entry can never match.
+        static const uint64_t OCCUPIED = 0x8000000000000000;
+
+        std::unique_ptr<Entry[]> entries;
+        size_t                   num_entries;
+        HashKey                  index_mask;
+
+    public:
+        // Atomic, like the entries, so that threads sharing the cache can count too. Relaxed: they're only statistics.
+        std::atomic<uint64_t> probes;
+        std::atomic<uint64_t> hits;
+
+        explicit EvalCache(size_t bytes);
+
+        // Uses the largest power of two number of entries that fits in the given size. Zero disables the cache.
+        void   resize(size_t bytes);
+        size_t size_in_bytes() const;
+        void   clear();
+
+        OINK_INLINE bool probe(HashKey key, PosEvaluation &eval)
+        {
+            if (!num_entries)
+                return false;
+
+            probes.fetch_add(1, std::memory_order_relaxed);
+
+            uint64_t entry = entries[key & index_mask].load(std::memory_order_relaxed);
+            if ((entry ^ (key | OCCUPIED)) >> 32)
+                return false;
+
+            hits.fetch_add(1, std::memory_order_relaxed);
+            eval = (PosEvaluation)(int32_t)(uint32_t)entry;
+            return true;
+        }
+
+        OINK_INLINE void store(HashKey key, PosEvaluation eval)
+        {
+            if (!num_entries)
+                return;
+
+            uint64_t entry = ((key | OCCUPIED) & 0xffffffff00000000) | (uint32_t)eval;
+            entries[key & index_mask].store(entry, std::memory_order_relaxed);
+        }
+    };
+}
+
+#endif // EVALCACHE_HPP
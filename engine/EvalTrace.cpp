@@ -0,0 +1,110 @@
+#include "EvalTrace.hpp"
+
+#include <cstring>
+
+namespace chess
+{
+    void EvalTrace::clear()
+    {
+        memset(coefficients, 0, sizeof(coefficients));
+        memset(untuned_parts, 0, sizeof(untuned_parts));
+        untuned = 0;
+        phase   = 0;
+    }
+
+    static void get_psq_weights(Score weights[], const PosEvaluation mg_table[], const PosEvaluation eg_table[])
+    {
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            weights[square] = make_score(mg_table[square], eg_table[square]);
+    }
+
+    void get_eval_weights(Score weights[eval_terms::NUM_TERMS])
+    {
+        using namespace eval_terms;
+
+        memset(weights, 0, NUM_TERMS * sizeof(Score));
+
+        for (Piece piece = pieces::WHITE_PAWN; piece <= pieces::WHITE_QUEEN; piece += 2)
+        {
+            int type = (piece - 1) >> 1;
+            if (piece != pieces::WHITE_KING)
+                weights[MATERIAL + type] = make_score(-evals::PIECE_CAPTURE_VALUES[piece], -evals::PIECE_CAPTURE_VALUES[piece]);
+            weights[MOBILITY + type] = evals::MOBILITY_WEIGHTS[piece];
+        }
+
+        get_psq_weights(weights + PSQ + 0 * 64, pst::pawn_mg,   pst::pawn_eg);
+        get_psq_weights(weights + PSQ + 1 * 64, pst::king_mg,   pst::king_eg);
+        get_psq_weights(weights + PSQ + 2 * 64, pst::rook_mg,   pst::rook_eg);
+        get_psq_weights(weights + PSQ + 3 * 64, pst::knight_mg, pst::knight_eg);
+        get_psq_weights(weights + PSQ + 4 * 64, pst::bishop_mg, pst::bishop_eg);
+        get_psq_weights(weights + PSQ + 5 * 64, pst::queen_mg,  pst::queen_eg);
+
+        for (int rank = 0; rank < 8; ++rank)
+        {
+            weights[PASSED_PAWN + rank]      = evals::PASSED_PAWN_BONUS[rank];
+            weights[CANDIDATE_PASSER + rank] = evals::CANDIDATE_PASSER_BONUS[rank];
+        }
+
+        weights[ISOLATED_PAWN]    = evals::ISOLATED_PAWN_PENALTY;
+        weights[DOUBLED_PAWN]     = evals::DOUBLED_PAWN_PENALTY;
+        weights[BACKWARD_PAWN]    = evals::BACKWARD_PAWN_PENALTY;
+        weights[UNBLOCKED_PASSER] = evals::UNBLOCKED_PASSER_BONUS;
+        weights[PAWN_SHIELD + 0]  = evals::PAWN_SHIELD_BONUS[0];
+        weights[PAWN_SHIELD + 1]  = evals::PAWN_SHIELD_BONUS[1];
+        weights[HANGING_PIECE]    = evals::HANGING_PIECE_PENALTY;
+        weights[THREAT_BY_PAWN]   = evals::THREAT_BY_PAWN_PENALTY;
+        weights[THREAT_BY_MINOR]  = evals::THREAT_BY_MINOR_PENALTY;
+    }
+
+    const char *term_group_name(int group)
+    {
+        static const char *const names[NUM_TERM_GROUPS] =
+        {
+            "Material", "Piece-square", "Imbalance", "Pawn structure", "Unblocked passers", "Pawn shield", "Mobility", "Threats", "King danger"
+        };
+        return names[group];
+    }
+
+    static Score sum_terms(const EvalTrace &trace, const Score weights[], int first_term, int end_term)
+    {
+        Score score = 0;
+        for (int term = first_term; term < end_term; ++term)
+            score += trace.coefficients[term] * weights[term];
+        return score;
+    }
+
+    void get_term_group_scores(const EvalTrace &trace, const Score weights[eval_terms::NUM_TERMS], Score groups[NUM_TERM_GROUPS])
+    {
+        using namespace eval_terms;
+
+        PosEvaluation material = 0;
+        for (int term = MATERIAL; term < PSQ; ++term)
+            material += trace.coefficients[term] * mg_value(weights[term]);
+
+        groups[TERMS_MATERIAL]         = make_score(material, material);
+        groups[TERMS_PSQ]              = sum_terms(trace, weights, PSQ,              PASSED_PAWN);
+        groups[TERMS_IMBALANCE]        = trace.untuned_parts[untuned_terms::IMBALANCE];
+        groups[TERMS_PAWN_STRUCTURE]   = sum_terms(trace, weights, PASSED_PAWN,      UNBLOCKED_PASSER);
+        groups[TERMS_UNBLOCKED_PASSER] = sum_terms(trace, weights, UNBLOCKED_PASSER, PAWN_SHIELD);
+        groups[TERMS_PAWN_SHIELD]      = sum_terms(trace, weights, PAWN_SHIELD,      MOBILITY);
+        groups[TERMS_MOBILITY]         = sum_terms(trace, weights, MOBILITY,         HANGING_PIECE);
+        groups[TERMS_THREATS]          = sum_terms(trace, weights, HANGING_PIECE,    NUM_TERMS);
+        groups[TERMS_KING_DANGER]      = trace.untuned_parts[untuned_terms::KING_DANGER];
+    }
+
+    PosEvaluation evaluate_trace(const EvalTrace &trace, const Score weights[eval_terms::NUM_TERMS])
+    {
+        using namespace eval_terms;
+
+        // Material isn't tapered.
+        PosEvaluation material = 0;
+        for (int term = MATERIAL; term < PSQ; ++term)
+            material += trace.coefficients[term] * mg_value(weights[term]);
+
+        Score score = trace.untuned;
+        for (int term = PSQ; term < NUM_TERMS; ++term)
+            score += trace.coefficients[term] * weights[term];
+
+        return material + taper(score, trace.phase);
+    }
+}
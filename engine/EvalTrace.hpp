@@ -0,0 +1,109 @@
+#ifndef EVALTRACE_HPP
+#define EVALTRACE_HPP
+
+#include "BasicTypes.hpp"
+#include "ChessConstants.hpp"
+
+namespace chess
+{
+    class Position;
+
+    // Every weight in EvalWeights.hpp gets a number, so that an evaluation can be broken down into a sum of
+    // (count of times a term applies) * (its weight), e.g. for tuning the weights.
+    namespace eval_terms
+    {
+        const int MATERIAL         = 0;                      // [piece type], as in (piece - 1) >> 1. Kings are never counted.
+        const int PSQ              = MATERIAL + 6;           // [piece type][square], squares as in the pst tables, i.e. a8 first
+        const int PASSED_PAWN      = PSQ + 6 * 64;           // [rank], from the pawn's side's point of view
+        const int CANDIDATE_PASSER = PASSED_PAWN + 8;        // [rank]
+        const int ISOLATED_PAWN    = CANDIDATE_PASSER + 8;
+        const int DOUBLED_PAWN     = ISOLATED_PAWN + 1;
+        const int BACKWARD_PAWN    = DOUBLED_PAWN + 1;
+        const int UNBLOCKED_PASSER = BACKWARD_PAWN + 1;
+        const int PAWN_SHIELD      = UNBLOCKED_PASSER + 1;   // [ranks in front of the king - 1]
+        const int MOBILITY         = PAWN_SHIELD + 2;        // [piece type]
+        const int HANGING_PIECE    = MOBILITY + 6;
+        const int THREAT_BY_PAWN   = HANGING_PIECE + 1;
+        const int THREAT_BY_MINOR  = THREAT_BY_PAWN + 1;
+
+        const int NUM_TERMS        = THREAT_BY_MINOR + 1;
+    }
+
+    // The parts of an evaluation that aren't made of weights, kept apart for reporting.
+    namespace untuned_terms
+    {
+        const int IMBALANCE   = 0;
+        const int KING_DANGER = 1;
+
+        const int NUM_TERMS   = 2;
+    }
+
+    // An evaluation, broken down by eval_terms, from white's point of view.
+    struct EvalTrace
+    {
+        int   coefficients[eval_terms::NUM_TERMS];  // White's count minus black's
+        Score untuned;                              // Everything that isn't a multiple of a weight, i.e. the sum of:
+        Score untuned_parts[untuned_terms::NUM_TERMS];
+        int   phase;                                // Capped at TOTAL_PHASE, as for tapering
+
+        void clear();
+
+        OINK_INLINE void add(int term, Side side, int count)
+        {
+            coefficients[term] += side == sides::white ? count : -count;
+        }
+
+        OINK_INLINE void add_untuned(int part, Side side, Score score)
+        {
+            untuned             += side == sides::white ? score : -score;
+            untuned_parts[part] += side == sides::white ? score : -score;
+        }
+    };
+
+    // Stands in for an EvalTrace when evaluating for real, so that tracing compiles away to nothing.
+    struct NoTrace
+    {
+        OINK_INLINE void add(int, Side, int) {}
+        OINK_INLINE void add_untuned(int, Side, Score) {}
+    };
+
+    // The weights that are compiled in, indexed by eval_terms. Piece values have the same middlegame and endgame value.
+    void get_eval_weights(Score weights[eval_terms::NUM_TERMS]);
+
+    // The terms again, grouped as they'd be talked about, for reports such as the test harness's eval breakdown.
+    enum EvalTermGroup
+    {
+        TERMS_MATERIAL,
+        TERMS_PSQ,
+        TERMS_IMBALANCE,
+        TERMS_PAWN_STRUCTURE,  // Passed, candidate, isolated, doubled and backward pawns
+        TERMS_UNBLOCKED_PASSER,
+        TERMS_PAWN_SHIELD,
+        TERMS_MOBILITY,
+        TERMS_THREATS,
+        TERMS_KING_DANGER,
+        NUM_TERM_GROUPS
+    };
+
+    const char *term_group_name(int group);
+
+    // What each group adds up to, from white's point of view and before tapering. Material isn't tapered, so its middlegame
+    // and endgame values are the same.
+    void get_term_group_scores(const EvalTrace &trace, const Score weights[eval_terms::NUM_TERMS], Score groups[NUM_TERM_GROUPS]);
+
+    // Blend middlegame and endgame values according to how much material is left, as the evaluation does.
+    OINK_INLINE PosEvaluation taper(Score score, int phase)
+    {
+        // Promotions can take the phase past its starting value.
+        if (phase > evals::TOTAL_PHASE)
+            phase = evals::TOTAL_PHASE;
+
+        return (mg_value(score) * phase + eg_value(score) * (evals::TOTAL_PHASE - phase)) / evals::TOTAL_PHASE;
+    }
+
+    // Puts a traced evaluation back together using the given weights, rounding just as eval_position() does.
+    // From white's point of view.
+    PosEvaluation evaluate_trace(const EvalTrace &trace, const Score weights[eval_terms::NUM_TERMS]);
+}
+
+#endif // EVALTRACE_HPP
@@ -2,9 +2,24 @@
 #include "Position.hpp"
 #include "MoveGenerator.hpp"
 #include "BasicOperations.hpp"
+#include "PawnHash.hpp"
+#include "EvalCache.hpp"
+#include "EvalTrace.hpp"
+#include "Material.hpp"
 
 //#include <display/ConsoleDisplay.hpp>
 
+#include <algorithm>
+#include <cstring>
+
+#ifdef OINK_EVAL_PROFILE
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+#endif
+
 using namespace chess::util;
 
 namespace chess
@@ -14,21 +29,8 @@ namespace chess
         if (!(pos.whole_board & ~pos.kings[sides::white] & ~pos.kings[sides::black]))
             return INSUFFICIENT_MATERIAL;
 
-        bool in_check = pos.detect_check(king_side);
-
-        MoveVector moves;
-        generate_all_moves(moves, pos, king_side);
-
-        Position test(pos);
-        bool any_legal = false;
-
-        for (uint32_t i = 0; i < moves.size; ++i)
-        {
-            any_legal = test.make_move(moves[i]);
-            if (any_legal)
-                break;
-            test = pos;
-        }
+        bool in_check  = pos.detect_check(king_side);
+        bool any_legal = has_any_legal_move(pos, king_side);
 
         if (in_check && !any_legal)
             return MATE;
@@ -40,17 +42,258 @@ namespace chess
             return NORMAL;
     }
 
-    // From POV of side to move.
-    PosEvaluation eval_position(Side side_to_move, const Position &pos, int depth)
+    // 16k entries of 64 bytes. Pawn structures repeat so much within a search that this is plenty.
+    static const size_t PAWN_HASH_ENTRIES = 1 << 14;
+    static PawnHashTable pawn_hash_table(PAWN_HASH_ENTRIES);
+
+    PawnHashTable &get_pawn_hash_table()
+    {
+        return pawn_hash_table;
+    }
+
+    static EvalCache eval_cache(DEFAULT_EVAL_CACHE_BYTES);
+
+    static uint64_t eval_stage_counts[NUM_EVAL_STAGES];
+
+    void reset_eval_stage_counts()
+    {
+        memset(eval_stage_counts, 0, sizeof(eval_stage_counts));
+    }
+
+    void get_eval_stage_counts(uint64_t counts[NUM_EVAL_STAGES])
     {
-        PositionType pos_type = test_position_type(pos, side_to_move);
-        if (pos_type == MATE)
+        memcpy(counts, eval_stage_counts, sizeof(eval_stage_counts));
+    }
+
+    static EvalProfile eval_profile;
+
+    void reset_eval_profile()
+    {
+        memset(&eval_profile, 0, sizeof(eval_profile));
+    }
+
+    EvalProfile get_eval_profile()
+    {
+        return eval_profile;
+    }
+
+#ifdef OINK_EVAL_PROFILE
+    // Charges the time since the last lap to each part of the evaluation as it finishes. Costs a couple of dozen cycles a lap.
+    struct EvalTimer
+    {
+        uint64_t last;
+
+        EvalTimer() : last(__rdtsc()) {}
+
+        OINK_INLINE void lap(EvalProfilePart part)
         {
-            return -(evals::MATE_SCORE + depth);
+            uint64_t now = __rdtsc();
+            eval_profile.cycles[part] += now - last;
+            ++eval_profile.calls[part];
+            last = now;
         }
-        else if (pos_type == STALEMATE || pos_type == INSUFFICIENT_MATERIAL)
+    };
+#else
+    struct EvalTimer
+    {
+        OINK_INLINE void lap(EvalProfilePart) {}
+    };
+#endif
+
+    EvalCache &get_eval_cache()
+    {
+        return eval_cache;
+    }
+
+    // Own pawns in front of the king. This depends on where the king is, so isn't cached with the rest of the pawn structure.
+    template<typename Trace>
+    static OINK_INLINE Score pawn_shield(const Position &pos, Side side, Trace &trace)
+    {
+        Bitboard in_front = shift_forward(pos.kings[side], side);
+        in_front |= shift_east(in_front) | shift_west(in_front);
+        Bitboard two_in_front = shift_forward(in_front, side);
+
+        trace.add(eval_terms::PAWN_SHIELD + 0, side, count_bits(pos.pawns[side] & in_front));
+        trace.add(eval_terms::PAWN_SHIELD + 1, side, count_bits(pos.pawns[side] & two_in_front));
+        return count_bits(pos.pawns[side] & in_front)     * evals::PAWN_SHIELD_BONUS[0] +
+               count_bits(pos.pawns[side] & two_in_front) * evals::PAWN_SHIELD_BONUS[1];
+    }
+
+    // Passed pawns with nothing in front of them at all.
+    template<typename Trace>
+    static OINK_INLINE Score unblocked_passers(const Position &pos, const PawnEntry &pawn_entry, Side side, Trace &trace)
+    {
+        Bitboard blocked = front_span(pos.whole_board, swap_side(side));
+        trace.add(eval_terms::UNBLOCKED_PASSER, side, count_bits(pawn_entry.passed[side] & ~blocked));
+        return count_bits(pawn_entry.passed[side] & ~blocked) * evals::UNBLOCKED_PASSER_BONUS;
+    }
+
+    // Attack sets for every piece, worked out once per evaluation and then shared by all the terms that need them.
+    struct AttackInfo
+    {
+        Bitboard by_piece[13];          // Union of the attacks of all pieces of each kind
+        Bitboard by_side[2];
+        Bitboard king_zone[2];          // The king's square and those next to it
+        int      king_attackers[2];     // Number of the side's pieces attacking the enemy king's zone
+        int      king_attack_units[2];  // See evals::KING_ATTACK_WEIGHTS
+    };
+
+    template<typename Trace>
+    static OINK_INLINE void add_piece_attacks(AttackInfo &info, Piece piece, Side side, Bitboard attacks, Bitboard mobility_area,
+                                              Score &score, Trace &trace)
+    {
+        info.by_piece[piece] |= attacks;
+        info.by_side[side]   |= attacks;
+
+        int mobility = count_bits(attacks & mobility_area) - evals::MOBILITY_BASELINE[piece];
+        score += mobility * evals::MOBILITY_WEIGHTS[piece];
+        trace.add(eval_terms::MOBILITY + ((piece - 1) >> 1), side, mobility);
+
+        Bitboard zone_attacks = attacks & info.king_zone[swap_side(side)];
+        if (zone_attacks)
+        {
+            ++info.king_attackers[side];
+            info.king_attack_units[side] += evals::KING_ATTACK_WEIGHTS[piece] * count_bits(zone_attacks);
+        }
+    }
+
+    // Fills in the side's attacks, and returns its mobility, from its own point of view.
+    // The king zones must already be set up, as must the pawn attacks, which come from the pawn hash.
+    template<typename Trace>
+    static Score evaluate_piece_attacks(const Position &pos, Side side, const PawnEntry &pawn_entry, AttackInfo &info, Trace &trace)
+    {
+        const Side other = swap_side(side);
+        const Bitboard mobility_area = ~pos.sides[side] & ~pawn_entry.attacks[other];
+        Score score = 0;
+        Square square;
+
+        for (Bitboard b = pos.knights[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            add_piece_attacks(info, pieces::KNIGHTS[side], side, moves::knight_moves[square], mobility_area, score, trace);
+        }
+
+        for (Bitboard b = pos.bishops[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            add_piece_attacks(info, pieces::BISHOPS[side], side, diagonal_attacks(square, pos.whole_board), mobility_area, score, trace);
+        }
+
+        for (Bitboard b = pos.rooks[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            add_piece_attacks(info, pieces::ROOKS[side], side, rank_file_attacks(square, pos.whole_board), mobility_area, score, trace);
+        }
+
+        for (Bitboard b = pos.queens[side]; b; )
         {
+            b = get_and_clear_first_occ_square(b, &square);
+            Bitboard attacks = rank_file_attacks(square, pos.whole_board) | diagonal_attacks(square, pos.whole_board);
+            add_piece_attacks(info, pieces::QUEENS[side], side, attacks, mobility_area, score, trace);
+        }
+
+        info.by_piece[pieces::PAWNS[side]] = pawn_entry.attacks[side];
+        info.by_piece[pieces::KINGS[side]] = info.king_zone[side] & ~pos.kings[side];
+        info.by_side[side] |= info.by_piece[pieces::PAWNS[side]] | info.by_piece[pieces::KINGS[side]];
+
+        return score;
+    }
+
+    // Threats to the side's pieces, and the danger to its king, from its own point of view. Needs both sides' attacks.
+    template<typename Trace>
+    static Score evaluate_threats(const Position &pos, Side side, const AttackInfo &info, Trace &trace)
+    {
+        const Side other = swap_side(side);
+        const Bitboard targets = pos.sides[side] & ~pos.pawns[side] & ~pos.kings[side];
+        const Bitboard heavies = pos.rooks[side] | pos.queens[side];
+        Score score = 0;
+
+        int hanging          = count_bits(targets & info.by_side[other] & ~info.by_side[side]);
+        int threats_by_pawn  = count_bits(targets & info.by_piece[pieces::PAWNS[other]]);
+        int threats_by_minor = count_bits(heavies & (info.by_piece[pieces::KNIGHTS[other]] | info.by_piece[pieces::BISHOPS[other]]));
+
+        score += hanging          * evals::HANGING_PIECE_PENALTY;
+        score += threats_by_pawn  * evals::THREAT_BY_PAWN_PENALTY;
+        score += threats_by_minor * evals::THREAT_BY_MINOR_PENALTY;
+        trace.add(eval_terms::HANGING_PIECE,   side, hanging);
+        trace.add(eval_terms::THREAT_BY_PAWN,  side, threats_by_pawn);
+        trace.add(eval_terms::THREAT_BY_MINOR, side, threats_by_minor);
+
+        // A single attacker on its own can rarely do much.
+        if (info.king_attackers[other] >= 2)
+        {
+            int units  = info.king_attack_units[other];
+            int danger = std::min(units * units / evals::KING_DANGER_DIVISOR, evals::KING_DANGER_MAX);
+            score -= make_score(danger, 0);
+            trace.add_untuned(untuned_terms::KING_DANGER, side, -make_score(danger, 0));
+        }
+
+        return score;
+    }
+
+    // Normally the pawns come from the hash table, but tracing needs them worked out in full.
+    static OINK_INLINE const PawnEntry &get_pawn_entry(const Position &pos, PawnEntry &, NoTrace &)
+    {
+        return pawn_hash_table.probe(pos);
+    }
+
+    static OINK_INLINE const PawnEntry &get_pawn_entry(const Position &pos, PawnEntry &entry, EvalTrace &trace)
+    {
+        trace_pawns(pos, entry, trace);
+        return entry;
+    }
+
+    static OINK_INLINE const MaterialEntry &get_material_entry(const Position &pos, MaterialEntry &overflow, NoTrace &)
+    {
+        return probe_material(pos, overflow);
+    }
+
+    // Tracing is only meant for positions without endgame knowledge (see has_endgame_knowledge()), so it goes without.
+    static OINK_INLINE const MaterialEntry &get_material_entry(const Position &pos, MaterialEntry &entry, EvalTrace &trace)
+    {
+        entry = probe_material(pos, entry);
+        entry.endgame.evaluation = NO_ENDGAME_EVALUATION;
+        entry.endgame.scaling[sides::white] = entry.endgame.scaling[sides::black] = NO_ENDGAME_SCALING;
+        trace.add_untuned(untuned_terms::IMBALANCE, sides::white, entry.imbalance);
+        return entry;
+    }
+
+    // Scales an evaluation from the side to move's point of view down towards a draw, if the side it favours has trouble winning.
+    static OINK_INLINE PosEvaluation scale_eval(const MaterialEntry &entry, const Position &pos, Side side_to_move, PosEvaluation eval)
+    {
+        Side ahead = eval > 0 ? side_to_move : swap_side(side_to_move);
+        if (entry.endgame.scaling[ahead] == NO_ENDGAME_SCALING)
+            return eval;
+
+        return eval * endgame_scale_factor(entry.endgame, pos, ahead) / SCALE_FACTOR_NORMAL;
+    }
+
+    // Whether an evaluation of eval so far, which the remaining terms could move by about margin, can't end up inside (alpha, beta).
+    static OINK_INLINE bool outside_window(PosEvaluation eval, PosEvaluation margin, PosEvaluation alpha, PosEvaluation beta)
+    {
+        return eval + margin <= alpha || eval - margin >= beta;
+    }
+
+    // The terms are added cheapest first, so that a lazy exit saves as much as possible. Sets the stage it finished at.
+    template<typename Trace>
+    static PosEvaluation evaluate(Side side_to_move, const Position &pos, PosEvaluation alpha, PosEvaluation beta, Trace &trace,
+                                  EvalStage &stage)
+    {
+        stage = EVAL_STAGE_FULL;
+        EvalTimer timer;
+
+        // Bare kings
+        if (!(pos.whole_board & ~pos.kings[sides::white] & ~pos.kings[sides::black]))
             return evals::DRAW_SCORE;
+
+        // Endings that the general evaluation doesn't understand.
+        MaterialEntry        overflow_entry;
+        const MaterialEntry &material_entry = get_material_entry(pos, overflow_entry, trace);
+        if (material_entry.endgame.evaluation != NO_ENDGAME_EVALUATION)
+        {
+            PosEvaluation endgame_eval = evaluate_endgame(material_entry.endgame, pos, side_to_move);
+            timer.lap(PROFILE_ENDGAME);
+            return side_to_move == material_entry.endgame.strong_side ? endgame_eval : -endgame_eval;
         }
 
         PosEvaluation eval = 0;
@@ -61,9 +304,101 @@ namespace chess
 
         eval += material_eval;
 
+        // Everything else is a (middlegame, endgame) pair, summed up and then blended by game phase in one go.
+        // The piece-square part is kept up to date incrementally, and the imbalance depends only on the material.
+        Score score = pos.psq + material_entry.imbalance;
+        timer.lap(PROFILE_MATERIAL);
+
+        PosEvaluation partial_eval = scale_eval(material_entry, pos, side_to_move, eval + material_sign * taper(score, material_entry.phase));
+        if (outside_window(partial_eval, evals::LAZY_MARGIN_MATERIAL, alpha, beta))
+        {
+            stage = EVAL_STAGE_MATERIAL;
+            return partial_eval;
+        }
+
+        PawnEntry traced_pawn_entry;
+        const PawnEntry &pawn_entry = get_pawn_entry(pos, traced_pawn_entry, trace);
+        score += pawn_entry.score;
+        score += pawn_shield(pos, sides::white, trace)                   - pawn_shield(pos, sides::black, trace);
+        score += unblocked_passers(pos, pawn_entry, sides::white, trace) - unblocked_passers(pos, pawn_entry, sides::black, trace);
+        timer.lap(PROFILE_PAWNS);
+
+        partial_eval = scale_eval(material_entry, pos, side_to_move, eval + material_sign * taper(score, material_entry.phase));
+        if (outside_window(partial_eval, evals::LAZY_MARGIN_PAWNS, alpha, beta))
+        {
+            stage = EVAL_STAGE_PAWNS;
+            return partial_eval;
+        }
+
+        AttackInfo attack_info;
+        memset(&attack_info, 0, sizeof(attack_info));
+        for (Side side = sides::white; side <= sides::black; ++side)
+            attack_info.king_zone[side] = moves::king_moves[get_first_occ_square(pos.kings[side])] | pos.kings[side];
+
+        score += evaluate_piece_attacks(pos, sides::white, pawn_entry, attack_info, trace) - evaluate_piece_attacks(pos, sides::black, pawn_entry, attack_info, trace);
+        timer.lap(PROFILE_PIECE_ATTACKS);
+        score += evaluate_threats(pos, sides::white, attack_info, trace)                   - evaluate_threats(pos, sides::black, attack_info, trace);
+        timer.lap(PROFILE_THREATS);
+
+        eval += material_sign * taper(score, material_entry.phase);
+        eval  = scale_eval(material_entry, pos, side_to_move, eval);
+
         // Generally worse to be in check
         //if (pos_type == CHECK)
         //    eval -= evals::CHECK_BIAS;        
         return eval;
     }
+
+    // From POV of side to move.
+    // Mate and stalemate are not detected here: that needs knowledge of whether there are any legal moves, which
+    // the search finds out for itself at interior nodes (and which would be far too expensive to establish at every leaf).
+    PosEvaluation eval_position(Side side_to_move, const Position &pos, PosEvaluation alpha, PosEvaluation beta)
+    {
+        HashKey key = pos.hash_key ^ (side_to_move == sides::black ? zobrist::black_to_move : 0);
+
+        PosEvaluation eval;
+        if (eval_cache.probe(key, eval))
+            return eval;
+
+        NoTrace   no_trace;
+        EvalStage stage;
+        eval = evaluate(side_to_move, pos, alpha, beta, no_trace, stage);
+        ++eval_stage_counts[stage];
+
+        // A lazy result is only a bound, and another search would come with a different window.
+        if (stage == EVAL_STAGE_FULL)
+            eval_cache.store(key, eval);
+        return eval;
+    }
+
+    PosEvaluation eval_position(Side side_to_move, const Position &pos)
+    {
+        return eval_position(side_to_move, pos, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+    }
+
+    PosEvaluation trace_evaluation(const Position &pos, EvalTrace &trace)
+    {
+        trace.clear();
+        // The same phase as the evaluation tapers with.
+        MaterialEntry overflow_entry;
+        trace.phase = probe_material(pos, overflow_entry).phase;
+
+        // Material and piece-square values are kept up to date by the Position, so aren't part of evaluate() as such.
+        Square square;
+        for (Bitboard b = pos.whole_board; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            Piece piece = pos.squares[square];
+            Side  side  = get_piece_side(piece);
+            int   type  = (piece - 1) >> 1;
+
+            if (piece != pieces::KINGS[side])
+                trace.add(eval_terms::MATERIAL + type, side, 1);
+            // The tables are white's, and a8 first.
+            trace.add(eval_terms::PSQ + type * 64 + (side == sides::white ? square ^ 56 : square), side, 1);
+        }
+
+        EvalStage stage;
+        return evaluate(sides::white, pos, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE, trace, stage);
+    }
 }
\ No newline at end of file
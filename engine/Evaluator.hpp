@@ -4,13 +4,73 @@
 #include "BasicTypes.hpp"
 #include "ChessConstants.hpp"
 
+#include <cstddef>
+
 namespace chess
 {
     class Position;
+    class PawnHashTable;
+    class EvalCache;
+    struct EvalTrace;
+
+    // Leaf evals are cheap enough that a cache much bigger than the CPU caches costs more in memory latency than it saves:
+    // on the harness bench positions, anything past a few MB is slower than no cache at all.
+    const size_t DEFAULT_EVAL_CACHE_BYTES = 1024 * 1024;
+    const size_t MAX_EVAL_CACHE_BYTES     = 2 * 1024 * 1024;
 
     util::PositionType test_position_type(const Position &pos, Side king_side);
 
-    PosEvaluation eval_position(Side side_to_move, const Position &pos, int depth);
+    PosEvaluation eval_position(Side side_to_move, const Position &pos);
+
+    // As above, but may stop early, once the score so far is far enough outside (alpha, beta) that the remaining terms
+    // are unlikely to bring it back in: the result is then only good as a bound, and isn't cached.
+    PosEvaluation eval_position(Side side_to_move, const Position &pos, PosEvaluation alpha, PosEvaluation beta);
+
+    // Where each evaluation finished: early after material and piece-square values, early after the pawns, or in full.
+    // Evaluations answered by the cache aren't counted.
+    enum EvalStage
+    {
+        EVAL_STAGE_MATERIAL,
+        EVAL_STAGE_PAWNS,
+        EVAL_STAGE_FULL,
+        NUM_EVAL_STAGES
+    };
+
+    // Counts since the last reset_eval_stage_counts().
+    void reset_eval_stage_counts();
+    void get_eval_stage_counts(uint64_t counts[NUM_EVAL_STAGES]);
+
+    // The parts of the evaluation that are timed in builds with OINK_EVAL_PROFILE defined, in the order they're done.
+    enum EvalProfilePart
+    {
+        PROFILE_ENDGAME,        // Material table lookup and a specialised endgame evaluation, for those that get one
+        PROFILE_MATERIAL,       // Material table lookup, material, piece-square and imbalance
+        PROFILE_PAWNS,          // Pawn hash, pawn shield and unblocked passers
+        PROFILE_PIECE_ATTACKS,  // Attack sets, mobility and king attackers
+        PROFILE_THREATS,        // Threats and king danger
+        NUM_PROFILE_PARTS
+    };
+
+    // Time stamp counter cycles spent in each part, and the number of times it was done, since the last reset_eval_profile().
+    // All zero unless built with OINK_EVAL_PROFILE.
+    struct EvalProfile
+    {
+        uint64_t cycles[NUM_PROFILE_PARTS];
+        uint64_t calls[NUM_PROFILE_PARTS];
+    };
+
+    void        reset_eval_profile();
+    EvalProfile get_eval_profile();
+
+    // The same as eval_position() from white's point of view, bypassing the caches, and breaking it down into the terms it's
+    // made of. Positions with bare kings are a draw whatever the weights, and endgame knowledge (see has_endgame_knowledge())
+    // is left out of the trace, so neither should be traced.
+    PosEvaluation trace_evaluation(const Position &pos, EvalTrace &trace);
+
+    // The pawn hash table used by eval_position(), e.g. for its statistics.
+    PawnHashTable &get_pawn_hash_table();
+    // The cache in front of eval_position(), to be resized, cleared, or have its statistics read.
+    EvalCache &get_eval_cache();
 }
 
 #endif // EVALUATOR_HPP
\ No newline at end of file
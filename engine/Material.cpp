@@ -0,0 +1,96 @@
+#include "Material.hpp"
+#include "Position.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+namespace chess
+{
+    // Table layout: each side's counts make a number, pawns most significant, then rooks, knights, bishops and queens.
+    static const int MAX_PAWNS   = 8;
+    static const int MAX_PIECES  = 2;  // Rooks, knights and bishops
+    static const int MAX_QUEENS  = 1;
+    static const int SIDE_COMBINATIONS = (MAX_PAWNS + 1) * (MAX_PIECES + 1) * (MAX_PIECES + 1) * (MAX_PIECES + 1) * (MAX_QUEENS + 1);
+    static const int NUM_ENTRIES       = SIDE_COMBINATIONS * SIDE_COMBINATIONS;  // 236k entries of 12 bytes
+
+    static std::once_flag                   material_table_built;
+    static std::unique_ptr<MaterialEntry[]> material_table;
+
+    static Score side_imbalance(const int counts[13], Side side)
+    {
+        int   pawns = counts[pieces::PAWNS[side]];
+        Score score = 0;
+
+        if (counts[pieces::BISHOPS[side]] >= 2)
+            score += evals::BISHOP_PAIR_BONUS;
+        score += counts[pieces::KNIGHTS[side]] * (pawns - 5) * evals::KNIGHT_PAWN_ADJUSTMENT;
+        score += counts[pieces::ROOKS[side]]   * (pawns - 5) * evals::ROOK_PAWN_ADJUSTMENT;
+
+        return score;
+    }
+
+    void evaluate_material(const int counts[13], MaterialEntry &entry)
+    {
+        entry.imbalance = side_imbalance(counts, sides::white) - side_imbalance(counts, sides::black);
+
+        int phase = 0;
+        for (Piece piece = pieces::WHITE_PAWN; piece <= pieces::BLACK_QUEEN; ++piece)
+            phase += counts[piece] * evals::PHASE_WEIGHTS[piece];
+        entry.phase = (unsigned char)std::min(phase, evals::TOTAL_PHASE);
+
+        select_endgame(counts, entry.endgame);
+    }
+
+    // The side's part of the table index, or -1 if it has more of something than the table covers.
+    static OINK_INLINE int side_index(HashKey key, Side side)
+    {
+        int pawns   = material_keys::count(key, pieces::PAWNS[side]);
+        int rooks   = material_keys::count(key, pieces::ROOKS[side]);
+        int knights = material_keys::count(key, pieces::KNIGHTS[side]);
+        int bishops = material_keys::count(key, pieces::BISHOPS[side]);
+        int queens  = material_keys::count(key, pieces::QUEENS[side]);
+
+        if (pawns > MAX_PAWNS || rooks > MAX_PIECES || knights > MAX_PIECES || bishops > MAX_PIECES || queens > MAX_QUEENS)
+            return -1;
+
+        return (((pawns * (MAX_PIECES + 1) + rooks) * (MAX_PIECES + 1) + knights) * (MAX_PIECES + 1) + bishops) * (MAX_QUEENS + 1) + queens;
+    }
+
+    static void build_material_table()
+    {
+        material_table.reset(new MaterialEntry[NUM_ENTRIES]);
+
+        int counts[13] = {};
+        for (int index = 0; index < NUM_ENTRIES; ++index)
+        {
+            for (Side side = sides::white; side <= sides::black; ++side)
+            {
+                int n = side == sides::white ? index / SIDE_COMBINATIONS : index % SIDE_COMBINATIONS;
+                counts[pieces::QUEENS[side]]  = n % (MAX_QUEENS + 1); n /= MAX_QUEENS + 1;
+                counts[pieces::BISHOPS[side]] = n % (MAX_PIECES + 1); n /= MAX_PIECES + 1;
+                counts[pieces::KNIGHTS[side]] = n % (MAX_PIECES + 1); n /= MAX_PIECES + 1;
+                counts[pieces::ROOKS[side]]   = n % (MAX_PIECES + 1); n /= MAX_PIECES + 1;
+                counts[pieces::PAWNS[side]]   = n;
+            }
+
+            evaluate_material(counts, material_table[index]);
+        }
+    }
+
+    const MaterialEntry &probe_material(const Position &pos, MaterialEntry &overflow)
+    {
+        std::call_once(material_table_built, build_material_table);
+
+        int white_index = side_index(pos.material_key, sides::white);
+        int black_index = side_index(pos.material_key, sides::black);
+        if (white_index >= 0 && black_index >= 0)
+            return material_table[white_index * SIDE_COMBINATIONS + black_index];
+
+        int counts[13];
+        for (Piece piece = 0; piece < 13; ++piece)
+            counts[piece] = material_keys::count(pos.material_key, piece);
+        evaluate_material(counts, overflow);
+        return overflow;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef MATERIAL_HPP
+#define MATERIAL_HPP
+
+#include "BasicTypes.hpp"
+#include "ChessConstants.hpp"
+#include "Endgame.hpp"
+
+namespace chess
+{
+    class Position;
+
+    // Everything the evaluator wants to know that depends only on how many of each piece there are.
+    struct MaterialEntry
+    {
+        Score            imbalance;  // Positive is good for white
+        unsigned char    phase;      // Game phase (see evals::PHASE_WEIGHTS), capped at TOTAL_PHASE
+        EndgameSelection endgame;
+    };
+
+    // Full calculation of the entry, from the numbers of each piece (indexed by piece, as in Position::piece_bbs).
+    void evaluate_material(const int counts[13], MaterialEntry &entry);
+
+    // The entry for the position's material, from a table of every combination of up to eight pawns, two each of rooks,
+    // knights and bishops, and one queen per side. The table is built the first time it's needed and only read after that,
+    // so it's shared by all threads. Anything it doesn't cover (after an underpromotion or a second queen) is worked out
+    // into overflow instead.
+    const MaterialEntry &probe_material(const Position &pos, MaterialEntry &overflow);
+}
+
+#endif // MATERIAL_HPP
@@ -14,10 +14,11 @@ namespace chess
 	* data has 32 bits
 	* source and destination square are on the interval [0, 63] or [0, 0b111111] or [0, 0x3f] => 6 bits each.
 	* the pieces fit into four bits.
-	* if we promote, castle, or do an en-passant capture with this move, we store the piece promoting to, or the relevant king, or the relevant pawn -- again 4 bits.
+	* if we promote, castle, or do an en-passant capture with this move, we store the piece promoting to, or the kind of castling (3 bits), or the relevant pawn (2 bits).
+	* the type (moves::MOVE_NORMAL etc.) sums up the above for make_move, so that it can go straight to the right handler. The setters keep it up to date.
 	layout (LSB on left):
 
-	[source:6][destination:6][piece:4][captured:4][promotion:4][castling:4][ep:4]
+	[source:6][destination:6][piece:4][captured:4][promotion:4][castling:3][ep:2][type:3]
 
 	*************/
 
@@ -32,15 +33,28 @@ namespace chess
 	    static const int CAPTURED_OFFSET    = 16;
 	    static const int PROMOTION_OFFSET   = 20;
         static const int CASTLING_OFFSET    = 24;
-        static const int EP_OFFSET          = 28;
+        static const int EP_OFFSET          = 27;
+        static const int TYPE_OFFSET        = 29;
 
 	    static const MoveData SOURCE_MASK      = 0x3f;
 	    static const MoveData DESTINATION_MASK = 0x3f << DESTINATION_OFFSET;
 	    static const MoveData PIECE_MASK       = 0xf  << PIECE_OFFSET;
 	    static const MoveData CAPTURED_MASK    = 0xf  << CAPTURED_OFFSET;
 	    static const MoveData PROMOTION_MASK   = 0xf  << PROMOTION_OFFSET;
-        static const MoveData CASTLING_MASK    = 0xf  << CASTLING_OFFSET;
-        static const MoveData EP_MASK          = 0xf  << EP_OFFSET;
+        static const MoveData CASTLING_MASK    = 0x7  << CASTLING_OFFSET;
+        static const MoveData EP_MASK          = 0x3  << EP_OFFSET;
+        static const MoveData TYPE_MASK        = 0x7u << TYPE_OFFSET;
+
+        OINK_INLINE void set_type(unsigned char type)
+        {
+            data = (data & ~TYPE_MASK) | ((MoveData)type << TYPE_OFFSET);
+        }
+
+        // Once a move isn't a promotion, castling or EP capture, whether it's a capture is all that's left.
+        OINK_INLINE unsigned char plain_type() const
+        {
+            return get_captured_piece() != pieces::NONE ? moves::MOVE_CAPTURE : moves::MOVE_NORMAL;
+        }
 
     public:
 		MoveData data;
@@ -82,6 +96,11 @@ namespace chess
 		    return (data & EP_MASK) >> EP_OFFSET;
 	    }
 
+        OINK_INLINE unsigned char get_type() const
+        {
+            return (data & TYPE_MASK) >> TYPE_OFFSET;
+        }
+
 	    OINK_INLINE void set_source(Square square)
 	    {
 		    data = (data & ~SOURCE_MASK) | (MoveData)square;
@@ -100,21 +119,28 @@ namespace chess
 	    OINK_INLINE void set_captured_piece(Piece piece)
 	    {
 		    data = (data & ~CAPTURED_MASK) | (piece << CAPTURED_OFFSET);
+            if (get_type() <= moves::MOVE_CAPTURE)
+                set_type(plain_type());
 	    }
 
 	    OINK_INLINE void set_promotion_piece(Piece piece)
 	    {
 		    data = (data & ~PROMOTION_MASK) | (piece << PROMOTION_OFFSET);
+            set_type(piece != pieces::NONE ? moves::MOVE_PROMOTION : plain_type());
 	    }
 
         OINK_INLINE void set_castling(Piece piece)
         {
+            assert(piece <= moves::CASTLING_BLACK_QUEENSIDE);
             data = (data & ~CASTLING_MASK) | (piece << CASTLING_OFFSET);
+            set_type(piece != moves::CASTLING_NONE ? moves::MOVE_CASTLING : plain_type());
         }
     
         OINK_INLINE void set_en_passant(Piece piece)
         {
+            assert(piece <= pieces::BLACK_PAWN);
             data = (data & ~EP_MASK) | (piece << EP_OFFSET);
+            set_type(piece != pieces::NONE ? moves::MOVE_EN_PASSANT : plain_type());
         }
 
         // Helpers
@@ -131,6 +157,77 @@ namespace chess
         }
 	};
 
+    /*************
+
+    A move in 16 bits, for tables where size counts more than decoding time. It keeps only what can't be got back from the
+    position it's played in: the pieces, and which castling or EP pawn, are looked up again by decode_move().
+	layout (LSB on left):
+
+	[source:6][destination:6][promotion:2][special:2]
+
+    * special is one of moves::MOVE16_NORMAL etc. Captures are normal moves.
+    * promotion is the piece promoted to, as rook, knight, bishop or queen (0-3), whichever side is promoting.
+
+	*************/
+
+    class Move16
+    {
+    public:
+        typedef uint16_t MoveData;
+
+    private:
+	    static const int DESTINATION_OFFSET = 6;
+	    static const int PROMOTION_OFFSET   = 12;
+	    static const int SPECIAL_OFFSET     = 14;
+
+	    static const MoveData SOURCE_MASK      = 0x3f;
+	    static const MoveData DESTINATION_MASK = 0x3f << DESTINATION_OFFSET;
+	    static const MoveData PROMOTION_MASK   = 0x3  << PROMOTION_OFFSET;
+
+    public:
+        MoveData data;
+
+        OINK_INLINE Move16() { data = 0; }
+
+        OINK_INLINE explicit Move16(Move move)
+        {
+            static const unsigned char SPECIALS[] =
+            {
+                moves::MOVE16_NORMAL, moves::MOVE16_NORMAL, moves::MOVE16_PROMOTION, moves::MOVE16_EN_PASSANT, moves::MOVE16_CASTLING
+            };
+
+            assert(move.get_type() <= moves::MOVE_CASTLING);
+
+            // Rooks, knights, bishops and queens are two apart, starting from the white rook.
+            Piece promotion = move.get_promotion_piece();
+            MoveData promotion_kind = promotion != pieces::NONE ? (promotion - pieces::WHITE_ROOK) >> 1 : 0;
+
+            data = (MoveData)(move.get_source() | (move.get_destination() << DESTINATION_OFFSET) |
+                              (promotion_kind << PROMOTION_OFFSET) | (SPECIALS[move.get_type()] << SPECIAL_OFFSET));
+        }
+
+        OINK_INLINE Square get_source() const
+        {
+            return data & SOURCE_MASK;
+        }
+
+        OINK_INLINE Square get_destination() const
+        {
+            return (data & DESTINATION_MASK) >> DESTINATION_OFFSET;
+        }
+
+        // The piece promoted to, for the given side. Only meaningful for promotions.
+        OINK_INLINE Piece get_promotion_piece(Side side) const
+        {
+            return Piece(pieces::WHITE_ROOK + (((data & PROMOTION_MASK) >> PROMOTION_OFFSET) << 1) + side);
+        }
+
+        OINK_INLINE unsigned char get_special() const
+        {
+            return data >> SPECIAL_OFFSET;
+        }
+    };
+
     // Simple movelist structure, avoiding heap allocation.
     // OINK_TODO: perhaps check if we reach limit, and resize.
     struct MoveVector
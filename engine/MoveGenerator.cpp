@@ -22,12 +22,29 @@ namespace chess
         }
 	}
 
-    static void generate_moves_from_destinations_with_promotion(Bitboard destinations, Move move, MoveVector &moves, const Position &position, Side side)
+    // Pawn moves are generated for all the pawns at once, so the sources come from the destinations, a fixed offset behind.
+    static OINK_INLINE void generate_pawn_moves_from_destinations(Bitboard destinations, int offset, Move move, MoveVector &moves,
+                                                                  const Position &position)
 	{
         Square dest_square;
 		while (destinations)
         {
 			destinations = get_and_clear_first_occ_square(destinations, &dest_square);
+            move.set_source(dest_square - offset);
+			move.set_destination(dest_square);
+			move.set_captured_piece(position.squares[dest_square]);
+            moves.push_back(move);
+        }
+	}
+
+    static void generate_promotions_from_destinations(Bitboard destinations, int offset, Move move, MoveVector &moves,
+                                                      const Position &position, Side side)
+	{
+        Square dest_square;
+		while (destinations)
+        {
+			destinations = get_and_clear_first_occ_square(destinations, &dest_square);
+            move.set_source(dest_square - offset);
 			move.set_destination(dest_square);
 			move.set_captured_piece(position.squares[dest_square]);
 			
@@ -45,98 +62,73 @@ namespace chess
         }
 	}
 
-    static void generate_ep_move(Bitboard destinations, Move move, MoveVector &moves, const Position &position, Side side)
-	{
-        if (destinations)
-        {
-            Square dest_square;
-		    destinations = get_and_clear_first_occ_square(destinations, &dest_square);
-		    move.set_destination(dest_square);
-		    move.set_captured_piece(pieces::PAWNS[swap_side(side)]);
-            move.set_en_passant(pieces::PAWNS[side]);
-            moves.push_back(move);
-        }
-
-        // There is a maximum of one EP capture available in a given position for a given pawn.
-        assert(!destinations);
-	}
-
-	void generate_king_moves(MoveVector &moves, const Position &position, Side side)
+    // Everything below up to generate_moves() is templated on the side, which is fixed for a whole call, so that the per-side
+    // constants fold away. The untemplated functions in MoveGenerator.hpp pick the instantiation once, at the top.
+    template<Side Us>
+	static void generate_king_moves(MoveVector &moves, const Position &position)
     {
+        typedef SideConstants<Us> C;
+
 		Move move;
-		move.set_piece(pieces::KINGS[side]);
+		move.set_piece(C::king);
 
-		Bitboard king = position.kings[side];
+		Bitboard king = position.kings[Us];
         assert(king);
 
 		Square square = get_first_occ_square(king);
 		move.set_source(square);
 
-        Bitboard destinations = moves::king_moves[square] & ~position.sides[side];
+        Bitboard destinations = moves::king_moves[square] & ~position.sides[Us];
 		generate_moves_from_destinations(destinations, move, moves, position);
 
-        if (side == sides::white && square == squares::e1)
+        if (square == C::king_start)
         {
-            if (position.castling_rights & sides::CASTLING_RIGHTS_WHITE_KINGSIDE)
+            if (position.castling_rights & C::kingside_rights)
             {
-                assert(position.squares[squares::h1] == pieces::WHITE_ROOK);
+                assert(position.squares[C::kingside_rook_from] == C::rook);
 
-                if (!(position.whole_board & moves::white_kingside_castling_mask))
+                if (!(position.whole_board & C::kingside_empty))
                 {
-                    move.set_destination(squares::g1);
-                    move.set_castling(moves::CASTLING_WHITE_KINGSIDE);
+                    move.set_destination(C::kingside_king_to);
+                    move.set_castling(C::kingside_castling);
                     moves.push_back(move);
                 }
             }
 
-            if (position.castling_rights & sides::CASTLING_RIGHTS_WHITE_QUEENSIDE)
+            if (position.castling_rights & C::queenside_rights)
             {
-                assert(position.squares[squares::a1] == pieces::WHITE_ROOK);
+                assert(position.squares[C::queenside_rook_from] == C::rook);
 
-                if (!(position.whole_board & moves::white_queenside_castling_mask))
+                if (!(position.whole_board & C::queenside_empty))
                 {
-                    move.set_destination(squares::c1);
-                    move.set_castling(moves::CASTLING_WHITE_QUEENSIDE);
+                    move.set_destination(C::queenside_king_to);
+                    move.set_castling(C::queenside_castling);
                     moves.push_back(move);
                 }
             }
         }
-        else if (side == sides::black && square == squares::e8)
-        {
-            if (position.castling_rights & sides::CASTLING_RIGHTS_BLACK_KINGSIDE)
-            {
-                assert(position.squares[squares::h8] == pieces::BLACK_ROOK);
-
-                if (!(position.whole_board & moves::black_kingside_castling_mask))
-                {
-                    move.set_destination(squares::g8);
-                    move.set_castling(moves::CASTLING_BLACK_KINGSIDE);
-                    moves.push_back(move);
-                }
-            }
-
-            if (position.castling_rights & sides::CASTLING_RIGHTS_BLACK_QUEENSIDE)
-            {
-                assert(position.squares[squares::a8] == pieces::BLACK_ROOK);
+    }
 
-                if (!(position.whole_board & moves::black_queenside_castling_mask))
-                {
-                    move.set_destination(squares::c8);
-                    move.set_castling(moves::CASTLING_BLACK_QUEENSIDE);
-                    moves.push_back(move);
-                }
-            }
-        }
+    void generate_king_moves(MoveVector &moves, const Position &position, Side side)
+    {
+        if (side == sides::white)
+            generate_king_moves<sides::white>(moves, position);
+        else
+            generate_king_moves<sides::black>(moves, position);
     }
 
-    void generate_knight_moves(MoveVector &moves, const Position &position, Side side)
+    // The piece generators below only produce moves to the target squares. Outside check, that's every square.
+    static const Bitboard ALL_TARGETS = ~util::nil;
+
+    template<Side Us>
+    static void generate_knight_moves(MoveVector &moves, const Position &position, Bitboard targets)
     {
 		Move move;
-		move.set_piece(pieces::KNIGHTS[side]);
+		move.set_piece(SideConstants<Us>::knight);
 
-        Bitboard knights        = position.knights[side];
-        Bitboard not_other_king = ~position.kings[swap_side(side)];
-        Bitboard not_my_side    = ~position.sides[side];
+        Bitboard knights        = position.knights[Us];
+        Bitboard not_other_king = ~position.kings[SideConstants<Us>::them];
+        Bitboard not_my_side    = ~position.sides[Us] & targets;
 
         Square source_sq;
         while (knights)
@@ -149,59 +141,83 @@ namespace chess
         }
     }
 
-	void generate_pawn_moves(MoveVector &moves, const Position &position, Side side)
+    void generate_knight_moves(MoveVector &moves, const Position &position, Side side)
+    {
+        if (side == sides::white)
+            generate_knight_moves<sides::white>(moves, position, ALL_TARGETS);
+        else
+            generate_knight_moves<sides::black>(moves, position, ALL_TARGETS);
+    }
+
+    template<Side Us>
+	static void generate_pawn_moves(MoveVector &moves, const Position &position, Bitboard targets)
     {
+        typedef SideConstants<Us> C;
+
 		Move move;
-		move.set_piece(pieces::PAWNS[side]);
+		move.set_piece(C::pawn);
 
-        Bitboard pawns          = position.pawns[side];
-        Bitboard other_side     = position.sides[swap_side(side)];
-        Bitboard not_other_king = ~position.kings[swap_side(side)];
+        Bitboard empty   = ~position.whole_board;
+        Bitboard enemies = position.sides[C::them] & ~position.kings[C::them];
 
-        Square source_sq;
-        while (pawns)
-        {
-            pawns = get_and_clear_first_occ_square(pawns, &source_sq);
-			move.set_source(source_sq);
+        // Each kind of move is one shift of all the pawns; the offsets are from source to destination.
+        Bitboard ahead = shift_forward(position.pawns[Us], Us);
 
-			RankFile rank = square_to_rank(source_sq);
-			Bitboard whole_board = position.whole_board;
-			if (rank == sides::STARTING_PAWN_RANKS[side])
-            {
-				whole_board = exclude_fourth_or_fifth_rank_if_third_or_sixth_occupied(whole_board, side);
-            }
-			// Since for pawns we're doing captures separately, we use whole_board here. We also exclude 4th(5th) rank if 3rd(6th) is occupied.
-            // Normal moves and promotions.
-			Bitboard destinations = moves::pawn_moves[side][source_sq] & ~whole_board;
+        Bitboard pushes        = ahead & empty;
+        Bitboard double_pushes = shift_forward(pushes & C::third_rank, Us) & empty & targets;
+        Bitboard east_captures = shift_east(ahead) & enemies & targets;
+        Bitboard west_captures = shift_west(ahead) & enemies & targets;
+        pushes &= targets;
 
-            // Normal captures
-			destinations |= moves::pawn_captures[side][source_sq] & other_side & not_other_king;
-            bool promoting = (rank == sides::ABOUT_TO_PROMOTE[side]); //if we're on the 7th or 2nd ranks, we're gonna promote.
-			
-            if (promoting)
-            {
-                generate_moves_from_destinations_with_promotion(destinations, move, moves, position, side);
-            }
-            else
+        generate_promotions_from_destinations(pushes        & C::last_rank, C::forward,     move, moves, position, Us);
+        generate_promotions_from_destinations(east_captures & C::last_rank, C::forward + 1, move, moves, position, Us);
+        generate_promotions_from_destinations(west_captures & C::last_rank, C::forward - 1, move, moves, position, Us);
+
+        generate_pawn_moves_from_destinations(pushes        & ~C::last_rank, C::forward,     move, moves, position);
+        generate_pawn_moves_from_destinations(double_pushes,                 2 * C::forward, move, moves, position);
+        generate_pawn_moves_from_destinations(east_captures & ~C::last_rank, C::forward + 1, move, moves, position);
+        generate_pawn_moves_from_destinations(west_captures & ~C::last_rank, C::forward - 1, move, moves, position);
+
+        // EP captures: ep_target_square is set if there is a valid target for an EP capture. When in check, it has to either
+        // take the checker or land in its way. They're never promotions.
+        if (position.ep_target_square != squares::NO_SQUARE)
+        {
+            Bitboard ep_bb       = util::one << position.ep_target_square;
+            Bitboard captured_bb = util::one << (position.ep_target_square - C::forward);
+            if ((ep_bb | captured_bb) & targets)
             {
-                generate_moves_from_destinations(destinations, move, moves, position);
-                
-                // EP captures are never promotions.
-                // EP captures: ep_target_square is set if there is a valid target for an EP capture. 
-                // The actual captured pawn will have to be fixed up later. 
-                // OINK_TODO: cleaner way?
-                Bitboard ep_bb = (position.ep_target_square == squares::NO_SQUARE) ? util::nil : util::one << position.ep_target_square;
-                destinations = moves::pawn_captures[side][source_sq] & ep_bb;
-                // There must be a maximum of one destination.
-                generate_ep_move(destinations, move, moves, position, side);
+                move.set_en_passant(C::pawn);
+                move.set_captured_piece(SideConstants<C::them>::pawn);
+                move.set_destination(position.ep_target_square);
+
+                if (shift_east(ahead) & ep_bb)
+                {
+                    move.set_source(position.ep_target_square - C::forward - 1);
+                    moves.push_back(move);
+                }
+                if (shift_west(ahead) & ep_bb)
+                {
+                    move.set_source(position.ep_target_square - C::forward + 1);
+                    moves.push_back(move);
+                }
             }
         }
     }
 
-	static void generate_rank_file_slider_moves(MoveVector &moves, const Position &position, Side side, Move &move, Bitboard moving_piece_bitboard)
+	void generate_pawn_moves(MoveVector &moves, const Position &position, Side side)
+    {
+        if (side == sides::white)
+            generate_pawn_moves<sides::white>(moves, position, ALL_TARGETS);
+        else
+            generate_pawn_moves<sides::black>(moves, position, ALL_TARGETS);
+    }
+
+    template<Side Us>
+	static void generate_rank_file_slider_moves(MoveVector &moves, const Position &position, Move &move, Bitboard moving_piece_bitboard,
+                                                Bitboard targets)
 	{
-        Bitboard not_other_king = ~position.kings[swap_side(side)];
-        Bitboard not_my_side    = ~position.sides[side];
+        Bitboard not_other_king = ~position.kings[SideConstants<Us>::them];
+        Bitboard not_my_side    = ~position.sides[Us] & targets;
 
 		while (moving_piece_bitboard)
 		{
@@ -226,13 +242,18 @@ namespace chess
     {
 		Move move;
 		move.set_piece(pieces::ROOKS[side]);
-		generate_rank_file_slider_moves(moves, position, side, move, position.rooks[side]);
+        if (side == sides::white)
+            generate_rank_file_slider_moves<sides::white>(moves, position, move, position.rooks[side], ALL_TARGETS);
+        else
+            generate_rank_file_slider_moves<sides::black>(moves, position, move, position.rooks[side], ALL_TARGETS);
     }
 
-	static void generate_diagonal_slider_moves(MoveVector &moves, const Position &position, Side side, Move &move, Bitboard moving_piece_bitboard)
+    template<Side Us>
+	static void generate_diagonal_slider_moves(MoveVector &moves, const Position &position, Move &move, Bitboard moving_piece_bitboard,
+                                               Bitboard targets)
 	{
-        Bitboard not_other_king = ~position.kings[swap_side(side)];
-        Bitboard not_my_side    = ~position.sides[side];
+        Bitboard not_other_king = ~position.kings[SideConstants<Us>::them];
+        Bitboard not_my_side    = ~position.sides[Us] & targets;
 
 		while (moving_piece_bitboard)
 		{
@@ -281,27 +302,606 @@ namespace chess
     {
 		Move move;
 		move.set_piece(pieces::BISHOPS[side]);
-		generate_diagonal_slider_moves(moves, position, side, move, position.bishops[side]);
+        if (side == sides::white)
+            generate_diagonal_slider_moves<sides::white>(moves, position, move, position.bishops[side], ALL_TARGETS);
+        else
+            generate_diagonal_slider_moves<sides::black>(moves, position, move, position.bishops[side], ALL_TARGETS);
     }
 
-	void generate_queen_moves(MoveVector &moves, const Position &position, Side side)
+    template<Side Us>
+	static void generate_queen_moves(MoveVector &moves, const Position &position, Bitboard targets)
 	{
 		Move rf_move;
-		rf_move.set_piece(pieces::QUEENS[side]);
-		generate_rank_file_slider_moves(moves, position, side, rf_move, position.queens[side]);
+		rf_move.set_piece(SideConstants<Us>::queen);
+		generate_rank_file_slider_moves<Us>(moves, position, rf_move, position.queens[Us], targets);
 
 		Move diag_move;
-		diag_move.set_piece(pieces::QUEENS[side]);
-		generate_diagonal_slider_moves(moves, position, side, diag_move, position.queens[side]);
+		diag_move.set_piece(SideConstants<Us>::queen);
+		generate_diagonal_slider_moves<Us>(moves, position, diag_move, position.queens[Us], targets);
 	}
-    
+
+	void generate_queen_moves(MoveVector &moves, const Position &position, Side side)
+	{
+        if (side == sides::white)
+            generate_queen_moves<sides::white>(moves, position, ALL_TARGETS);
+        else
+            generate_queen_moves<sides::black>(moves, position, ALL_TARGETS);
+	}
+
+    template<Side Us>
+	void generate_all_moves(MoveVector &moves, const Position &position)
+    {
+        typedef SideConstants<Us> C;
+
+        generate_pawn_moves<Us>(moves, position, ALL_TARGETS);
+        generate_queen_moves<Us>(moves, position, ALL_TARGETS);
+
+        Move move;
+        move.set_piece(C::bishop);
+        generate_diagonal_slider_moves<Us>(moves, position, move, position.bishops[Us], ALL_TARGETS);
+        move.set_piece(C::rook);
+        generate_rank_file_slider_moves<Us>(moves, position, move, position.rooks[Us], ALL_TARGETS);
+
+        generate_knight_moves<Us>(moves, position, ALL_TARGETS);
+        generate_king_moves<Us>(moves, position);
+    }
+
+    template<Side Us>
+    void generate_evasions(MoveVector &moves, const Position &position)
+    {
+        typedef SideConstants<Us> C;
+
+        Bitboard checkers    = position.checkers(Us);
+        Square   king_square = get_first_occ_square(position.kings[Us]);
+        assert(checkers);
+
+        // Anything other than a king move has to take the checker or block it, which is impossible against two at once.
+        if (!(checkers & (checkers - 1)))
+        {
+            Square   checker_square = get_first_occ_square(checkers);
+            Bitboard targets        = checkers | between(king_square, checker_square);
+
+            generate_pawn_moves<Us>(moves, position, targets);
+            generate_queen_moves<Us>(moves, position, targets);
+
+            Move move;
+            move.set_piece(C::bishop);
+            generate_diagonal_slider_moves<Us>(moves, position, move, position.bishops[Us], targets);
+            move.set_piece(C::rook);
+            generate_rank_file_slider_moves<Us>(moves, position, move, position.rooks[Us], targets);
+
+            generate_knight_moves<Us>(moves, position, targets);
+        }
+
+        // Only steps to safe squares: lift the king off the board, so that it doesn't shadow a slider's line behind it.
+        // Castling is never allowed out of check.
+        Move move;
+        move.set_piece(C::king);
+        move.set_source(king_square);
+
+        Bitboard occupancy_without_king = position.whole_board ^ position.kings[Us];
+        Bitboard destinations           = moves::king_moves[king_square] & ~position.sides[Us];
+        Square dest_square;
+        while (destinations)
+        {
+            destinations = get_and_clear_first_occ_square(destinations, &dest_square);
+            if (!position.square_attacked(dest_square, Us, occupancy_without_king))
+            {
+                move.set_destination(dest_square);
+                move.set_captured_piece(position.squares[dest_square]);
+                moves.push_back(move);
+            }
+        }
+    }
+
+    template<Side Us>
+    void generate_moves(MoveVector &moves, const Position &position)
+    {
+        if (position.checkers(Us))
+            generate_evasions<Us>(moves, position);
+        else
+            generate_all_moves<Us>(moves, position);
+    }
+
+    template void generate_all_moves<sides::white>(MoveVector &moves, const Position &position);
+    template void generate_all_moves<sides::black>(MoveVector &moves, const Position &position);
+    template void generate_evasions<sides::white>(MoveVector &moves, const Position &position);
+    template void generate_evasions<sides::black>(MoveVector &moves, const Position &position);
+    template void generate_moves<sides::white>(MoveVector &moves, const Position &position);
+    template void generate_moves<sides::black>(MoveVector &moves, const Position &position);
+
 	void generate_all_moves(MoveVector &moves, const Position &position, Side side)
     {
-        generate_pawn_moves(moves,   position, side);
-        generate_queen_moves(moves,  position, side);
-        generate_bishop_moves(moves, position, side);
-        generate_rook_moves(moves,   position, side);
-        generate_knight_moves(moves, position, side);
-        generate_king_moves(moves,   position, side);
+        if (side == sides::white)
+            generate_all_moves<sides::white>(moves, position);
+        else
+            generate_all_moves<sides::black>(moves, position);
+    }
+
+    void generate_evasions(MoveVector &moves, const Position &position, Side side)
+    {
+        if (side == sides::white)
+            generate_evasions<sides::white>(moves, position);
+        else
+            generate_evasions<sides::black>(moves, position);
+    }
+
+    // Where a piece on the source square can go to give check: the direct check squares, plus, if moving it uncovers a slider
+    // behind it, anywhere off the line to the enemy king.
+    static OINK_INLINE Bitboard checking_destinations(Square source_sq, Bitboard direct, Bitboard candidates, Square king_square)
+    {
+        if (candidates & (util::one << source_sq))
+            return direct | ~line_through(king_square, source_sq);
+        return direct;
+    }
+
+    static void generate_quiet_checks_by(MoveVector &moves, const Position &position, Piece piece, Bitboard movers,
+                                         Bitboard candidates, Square king_square)
+    {
+        Move move;
+        move.set_piece(piece);
+
+        Bitboard direct = position.check_squares(piece);
+        Bitboard empty  = ~position.whole_board;
+
+        Square source_sq;
+        while (movers)
+        {
+            movers = get_and_clear_first_occ_square(movers, &source_sq);
+            move.set_source(source_sq);
+
+            Bitboard destinations;
+            switch (piece)
+            {
+            case pieces::WHITE_KNIGHT:
+            case pieces::BLACK_KNIGHT:
+                destinations = moves::knight_moves[source_sq];
+                break;
+            case pieces::WHITE_BISHOP:
+            case pieces::BLACK_BISHOP:
+                destinations = diagonal_attacks(source_sq, position.whole_board);
+                break;
+            case pieces::WHITE_ROOK:
+            case pieces::BLACK_ROOK:
+                destinations = rank_file_attacks(source_sq, position.whole_board);
+                break;
+            default:
+                destinations = diagonal_attacks(source_sq, position.whole_board) | rank_file_attacks(source_sq, position.whole_board);
+                break;
+            }
+
+            destinations &= empty & checking_destinations(source_sq, direct, candidates, king_square);
+            generate_moves_from_destinations(destinations, move, moves, position);
+        }
+    }
+
+    void generate_quiet_checks(MoveVector &moves, const Position &position, Side side)
+    {
+        Side     other_side  = swap_side(side);
+        Square   king_square = get_first_occ_square(position.kings[other_side]);
+        Bitboard candidates  = position.discovered_check_candidates(side);
+
+        // Pushes, bar promotions.
+        Move move;
+        move.set_piece(pieces::PAWNS[side]);
+
+        Bitboard direct = position.check_squares(pieces::PAWNS[side]);
+        Bitboard pawns  = position.pawns[side] & ~moves::eightbit_rank_masks[sides::ABOUT_TO_PROMOTE[side]];
+        Square source_sq;
+        while (pawns)
+        {
+            pawns = get_and_clear_first_occ_square(pawns, &source_sq);
+            move.set_source(source_sq);
+
+            Bitboard whole_board = position.whole_board;
+            if (square_to_rank(source_sq) == sides::STARTING_PAWN_RANKS[side])
+                whole_board = exclude_fourth_or_fifth_rank_if_third_or_sixth_occupied(whole_board, side);
+
+            Bitboard destinations = moves::pawn_moves[side][source_sq] & ~whole_board &
+                                    checking_destinations(source_sq, direct, candidates, king_square);
+            generate_moves_from_destinations(destinations, move, moves, position);
+        }
+
+        generate_quiet_checks_by(moves, position, pieces::QUEENS[side],  position.queens[side],  candidates, king_square);
+        generate_quiet_checks_by(moves, position, pieces::BISHOPS[side], position.bishops[side], candidates, king_square);
+        generate_quiet_checks_by(moves, position, pieces::ROOKS[side],   position.rooks[side],   candidates, king_square);
+        generate_quiet_checks_by(moves, position, pieces::KNIGHTS[side], position.knights[side], candidates, king_square);
+
+        // The king can only give a discovered check. Checks by the rook as it castles aren't included.
+        Bitboard king = position.kings[side] & candidates;
+        if (king)
+        {
+            Square from = get_first_occ_square(king);
+            move.set_piece(pieces::KINGS[side]);
+            move.set_source(from);
+            Bitboard destinations = moves::king_moves[from] & ~position.whole_board & ~line_through(king_square, from);
+            generate_moves_from_destinations(destinations, move, moves, position);
+        }
+    }
+
+    // Where the rook ends up, indexed by the move's castling field.
+    static const Square CASTLING_ROOK_DESTINATIONS[] = { squares::NO_SQUARE, squares::f1, squares::d1, squares::f8, squares::d8 };
+    static const Square CASTLING_ROOK_SOURCES[]      = { squares::NO_SQUARE, squares::h1, squares::a1, squares::h8, squares::a8 };
+
+    bool gives_check(const Position &position, Move move)
+    {
+        Piece    piece       = move.get_piece();
+        Side     side        = get_piece_side(piece);
+        Square   source      = move.get_source();
+        Square   dest        = move.get_destination();
+        Square   king_square = get_first_occ_square(position.kings[swap_side(side)]);
+        Bitboard king        = position.kings[swap_side(side)];
+        Piece    promotion   = move.get_promotion_piece();
+
+        // Direct. A promoted piece's lines aren't in the check squares, which were worked out with the pawn still in the way.
+        if (promotion == pieces::NONE)
+        {
+            if (position.check_squares(piece) & (util::one << dest))
+                return true;
+        }
+        else
+        {
+            Bitboard occupancy = position.whole_board ^ (util::one << source);
+            switch (promotion)
+            {
+            case pieces::WHITE_KNIGHT:
+            case pieces::BLACK_KNIGHT:
+                if (moves::knight_moves[dest] & king)
+                    return true;
+                break;
+            case pieces::WHITE_BISHOP:
+            case pieces::BLACK_BISHOP:
+                if (diagonal_attacks(dest, occupancy) & king)
+                    return true;
+                break;
+            case pieces::WHITE_ROOK:
+            case pieces::BLACK_ROOK:
+                if (rank_file_attacks(dest, occupancy) & king)
+                    return true;
+                break;
+            default:
+                if ((diagonal_attacks(dest, occupancy) | rank_file_attacks(dest, occupancy)) & king)
+                    return true;
+                break;
+            }
+        }
+
+        // Discovered, by moving off the line between a slider and the king.
+        if ((position.discovered_check_candidates(side) & (util::one << source)) && !aligned(source, dest, king_square))
+            return true;
+
+        unsigned char castling = move.get_castling();
+        if (castling != moves::CASTLING_NONE)
+        {
+            // The king can't give check, but the rook can, along the rank or, with the king gone, its file.
+            Square   rook_dest = CASTLING_ROOK_DESTINATIONS[castling];
+            Bitboard occupancy = position.whole_board ^ (util::one << source) ^ (util::one << CASTLING_ROOK_SOURCES[castling]) ^
+                                 (util::one << dest) ^ (util::one << rook_dest);
+            return (rank_file_attacks(rook_dest, occupancy) & king) != util::nil;
+        }
+
+        if (move.get_en_passant() != pieces::NONE)
+        {
+            // Taking the pawn can uncover a slider through its square, which no pin test would find.
+            Square   captured_square = dest - sides::NEXT_RANK_OFFSET[side];
+            Bitboard occupancy       = position.whole_board ^ (util::one << source) ^ (util::one << captured_square) ^ (util::one << dest);
+            return ((rank_file_attacks(king_square, occupancy) & (position.rooks[side]   | position.queens[side])) |
+                    (diagonal_attacks(king_square, occupancy)  & (position.bishops[side] | position.queens[side]))) != util::nil;
+        }
+
+        return false;
+    }
+
+    // What each kind of castling needs, indexed by the move's castling field.
+    struct CastlingRequirements
+    {
+        Square        king_source, king_destination;
+        unsigned char rights;
+        Bitboard      empty_squares; // Between king and rook
+        Bitboard      king_path;     // Squares that mustn't be attacked before the destination, the king's own included
+    };
+
+    static const CastlingRequirements CASTLING_REQUIREMENTS[] =
+    {
+        { squares::NO_SQUARE, squares::NO_SQUARE, 0, util::nil, util::nil },
+        { squares::e1, squares::g1, sides::CASTLING_RIGHTS_WHITE_KINGSIDE,  moves::white_kingside_castling_mask,  moves::white_kingside_king_path  },
+        { squares::e1, squares::c1, sides::CASTLING_RIGHTS_WHITE_QUEENSIDE, moves::white_queenside_castling_mask, moves::white_queenside_king_path },
+        { squares::e8, squares::g8, sides::CASTLING_RIGHTS_BLACK_KINGSIDE,  moves::black_kingside_castling_mask,  moves::black_kingside_king_path  },
+        { squares::e8, squares::c8, sides::CASTLING_RIGHTS_BLACK_QUEENSIDE, moves::black_queenside_castling_mask, moves::black_queenside_king_path },
+    };
+
+    bool is_pseudo_legal(const Position &position, Move move)
+    {
+        Piece  piece     = move.get_piece();
+        Square source    = move.get_source();
+        Square dest      = move.get_destination();
+        Piece  captured  = move.get_captured_piece();
+        Piece  promotion = move.get_promotion_piece();
+
+        if (piece == pieces::NONE || piece > pieces::BLACK_QUEEN || position.squares[source] != piece)
+            return false;
+
+        Side     side        = get_piece_side(piece);
+        Bitboard dest_bb     = util::one << dest;
+        bool     is_pawn     = piece == pieces::PAWNS[side];
+        bool     is_king     = piece == pieces::KINGS[side];
+        unsigned char castling = move.get_castling();
+
+        if ((castling != moves::CASTLING_NONE && !is_king) || (move.get_en_passant() != pieces::NONE && !is_pawn) ||
+            (promotion != pieces::NONE && !is_pawn))
+            return false;
+
+        // make_move goes by the type alone, so it has to agree with the rest.
+        unsigned char type = castling != moves::CASTLING_NONE          ? moves::MOVE_CASTLING :
+                             move.get_en_passant() != pieces::NONE     ? moves::MOVE_EN_PASSANT :
+                             promotion != pieces::NONE                 ? moves::MOVE_PROMOTION :
+                             captured != pieces::NONE                  ? moves::MOVE_CAPTURE : moves::MOVE_NORMAL;
+        if (move.get_type() != type)
+            return false;
+
+        // En passant is the one move whose captured piece isn't on the destination.
+        if (move.get_en_passant() != pieces::NONE)
+        {
+            return move.get_en_passant() == piece && promotion == pieces::NONE && dest == position.ep_target_square &&
+                   captured == pieces::PAWNS[swap_side(side)] && (moves::pawn_captures[side][source] & dest_bb);
+        }
+
+        // Nothing takes its own side's pieces, or the king.
+        if (captured != position.squares[dest] || (dest_bb & position.sides[side]) || (dest_bb & position.kings[swap_side(side)]))
+            return false;
+
+        if (castling != moves::CASTLING_NONE)
+        {
+            if (castling > moves::CASTLING_BLACK_QUEENSIDE)
+                return false;
+
+            // Each side can only use its own rights.
+            const CastlingRequirements &requirements = CASTLING_REQUIREMENTS[castling];
+            return source == requirements.king_source && dest == requirements.king_destination &&
+                   (sides::CASTLING_RIGHTS_ANY[side] & requirements.rights) &&
+                   (position.castling_rights & requirements.rights) && !(position.whole_board & requirements.empty_squares);
+        }
+
+        Bitboard destinations;
+        switch (piece)
+        {
+        case pieces::WHITE_PAWN:
+        case pieces::BLACK_PAWN:
+            {
+                // Promotions have to say what to, and only to one of the side's own pieces, other than a king.
+                bool promoting = square_to_rank(source) == sides::ABOUT_TO_PROMOTE[side];
+                if (promoting != (promotion != pieces::NONE))
+                    return false;
+                if (promoting && promotion != pieces::QUEENS[side] && promotion != pieces::ROOKS[side] &&
+                    promotion != pieces::BISHOPS[side] && promotion != pieces::KNIGHTS[side])
+                    return false;
+
+                if (captured != pieces::NONE)
+                    return (moves::pawn_captures[side][source] & dest_bb) != util::nil;
+
+                Bitboard whole_board = position.whole_board;
+                if (square_to_rank(source) == sides::STARTING_PAWN_RANKS[side])
+                    whole_board = exclude_fourth_or_fifth_rank_if_third_or_sixth_occupied(whole_board, side);
+                return (moves::pawn_moves[side][source] & ~whole_board & dest_bb) != util::nil;
+            }
+        case pieces::WHITE_KNIGHT:
+        case pieces::BLACK_KNIGHT:
+            destinations = moves::knight_moves[source];
+            break;
+        case pieces::WHITE_BISHOP:
+        case pieces::BLACK_BISHOP:
+            destinations = diagonal_attacks(source, position.whole_board);
+            break;
+        case pieces::WHITE_ROOK:
+        case pieces::BLACK_ROOK:
+            destinations = rank_file_attacks(source, position.whole_board);
+            break;
+        case pieces::WHITE_QUEEN:
+        case pieces::BLACK_QUEEN:
+            destinations = diagonal_attacks(source, position.whole_board) | rank_file_attacks(source, position.whole_board);
+            break;
+        default:
+            destinations = moves::king_moves[source];
+            break;
+        }
+
+        return (destinations & dest_bb) != util::nil;
+    }
+
+    Move decode_move(const Position &position, Move16 compact)
+    {
+        Square source = compact.get_source();
+        Square dest   = compact.get_destination();
+        Piece  piece  = position.squares[source];
+        Side   side   = get_piece_side(piece);
+
+        Move move;
+        move.set_piece(piece);
+        move.set_source(source);
+        move.set_destination(dest);
+
+        switch (compact.get_special())
+        {
+        case moves::MOVE16_EN_PASSANT:
+            move.set_en_passant(pieces::PAWNS[side]);
+            move.set_captured_piece(pieces::PAWNS[swap_side(side)]);
+            break;
+
+        case moves::MOVE16_CASTLING:
+            // Which castling it is follows from the king's destination.
+            for (unsigned char castling = moves::CASTLING_WHITE_KINGSIDE; castling <= moves::CASTLING_BLACK_QUEENSIDE; ++castling)
+            {
+                if (CASTLING_REQUIREMENTS[castling].king_source == source && CASTLING_REQUIREMENTS[castling].king_destination == dest)
+                    move.set_castling(castling);
+            }
+            break;
+
+        case moves::MOVE16_PROMOTION:
+            move.set_captured_piece(position.squares[dest]);
+            move.set_promotion_piece(compact.get_promotion_piece(side));
+            break;
+
+        default:
+            move.set_captured_piece(position.squares[dest]);
+            break;
+        }
+
+        return move;
+    }
+
+    bool is_legal(const Position &position, Move move)
+    {
+        assert(is_pseudo_legal(position, move));
+
+        Piece    piece       = move.get_piece();
+        Side     side        = get_piece_side(piece);
+        Side     other_side  = swap_side(side);
+        Square   source      = move.get_source();
+        Square   dest        = move.get_destination();
+        Square   king_square = get_first_occ_square(position.kings[side]);
+
+        unsigned char castling = move.get_castling();
+        if (castling != moves::CASTLING_NONE)
+            return !(position.attacks_by(other_side) & (CASTLING_REQUIREMENTS[castling].king_path | (util::one << dest)));
+
+        // The king mustn't step into an attack, with itself lifted off, so that it doesn't shadow a slider's line behind it.
+        if (piece == pieces::KINGS[side])
+            return !position.square_attacked(dest, side, position.whole_board ^ position.kings[side]);
+
+        // En passant takes two pieces off one line, which no pin test can see through: look at the board as it'll be.
+        if (move.get_en_passant() != pieces::NONE)
+        {
+            Bitboard captured_bb = util::one << (dest - sides::NEXT_RANK_OFFSET[side]);
+            Bitboard occupancy   = position.whole_board ^ (util::one << source) ^ captured_bb ^ (util::one << dest);
+            return !(position.attackers_to(king_square, occupancy) & position.sides[other_side] & ~captured_bb);
+        }
+
+        // In check, the move has to take the checker or block it, which is impossible against two at once.
+        Bitboard checkers = position.checkers(side);
+        if (checkers)
+        {
+            if (checkers & (checkers - 1))
+                return false;
+            if (!((checkers | between(king_square, get_first_occ_square(checkers))) & (util::one << dest)))
+                return false;
+        }
+
+        // A pinned piece can only move along the pin.
+        return !(position.pinned(side) & (util::one << source)) || aligned(source, dest, king_square);
+    }
+
+    Move parse_coordinate_move(const Position &position, Side side, const char *text)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            if (text[i] < (i % 2 ? '1' : 'a') || text[i] > (i % 2 ? '8' : 'h'))
+                return Move();
+        }
+
+        Square source = rank_file_to_square(text[1] - '1', text[0] - 'a');
+        Square dest   = rank_file_to_square(text[3] - '1', text[2] - 'a');
+
+        Piece promotion = pieces::NONE;
+        switch (text[4])
+        {
+        case 'n': promotion = pieces::KNIGHTS[side]; break;
+        case 'b': promotion = pieces::BISHOPS[side]; break;
+        case 'r': promotion = pieces::ROOKS[side];   break;
+        case 'q': promotion = pieces::QUEENS[side];  break;
+        }
+
+        // Matched against the generated moves, so that the captured piece, EP and castling come out just as they do there.
+        MoveVector moves;
+        generate_moves(moves, position, side);
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            Move move = moves[i];
+            if (move.get_source() == source && move.get_destination() == dest && move.get_promotion_piece() == promotion)
+                return is_legal(position, move) ? move : Move();
+        }
+
+        return Move();
+    }
+
+    void generate_moves(MoveVector &moves, const Position &position, Side side)
+    {
+        if (side == sides::white)
+            generate_moves<sides::white>(moves, position);
+        else
+            generate_moves<sides::black>(moves, position);
+    }
+
+    bool has_any_legal_move(const Position &position, Side side)
+    {
+        Side     other_side  = swap_side(side);
+        Bitboard own         = position.sides[side];
+        Square   king_square = get_first_occ_square(position.kings[side]);
+
+        // King steps. Lift the king off the board, so that it doesn't shadow a slider's line behind it.
+        // Castling needn't be considered: if it's legal, then so is the single step towards the rook.
+        Bitboard occupancy_without_king = position.whole_board ^ position.kings[side];
+        Bitboard king_destinations      = moves::king_moves[king_square] & ~own;
+        Square dest_square;
+        while (king_destinations)
+        {
+            king_destinations = get_and_clear_first_occ_square(king_destinations, &dest_square);
+            if (!position.square_attacked(dest_square, side, occupancy_without_king))
+                return true;
+        }
+
+        // Out of check, any pseudo-legal move by a piece which isn't pinned is legal -- bar EP, which is left to the slow path.
+        if (!position.checkers(side))
+        {
+            Bitboard not_pinned = ~position.pinned(side);
+            Bitboard targets    = ~own & ~position.kings[other_side];
+            Square source_sq;
+
+            Bitboard knights = position.knights[side] & not_pinned;
+            while (knights)
+            {
+                knights = get_and_clear_first_occ_square(knights, &source_sq);
+                if (moves::knight_moves[source_sq] & targets)
+                    return true;
+            }
+
+            Bitboard pawns = position.pawns[side] & not_pinned;
+            Bitboard single_pushes = side == sides::white ? pawns << 8 : pawns >> 8;
+            if (single_pushes & ~position.whole_board)
+                return true;
+            while (pawns)
+            {
+                pawns = get_and_clear_first_occ_square(pawns, &source_sq);
+                if (moves::pawn_captures[side][source_sq] & position.sides[other_side] & targets)
+                    return true;
+            }
+
+            Bitboard rank_file_men = (position.rooks[side] | position.queens[side]) & not_pinned;
+            while (rank_file_men)
+            {
+                rank_file_men = get_and_clear_first_occ_square(rank_file_men, &source_sq);
+                if (rank_file_attacks(source_sq, position.whole_board) & targets)
+                    return true;
+            }
+
+            Bitboard diagonal_men = (position.bishops[side] | position.queens[side]) & not_pinned;
+            while (diagonal_men)
+            {
+                diagonal_men = get_and_clear_first_occ_square(diagonal_men, &source_sq);
+                if (diagonal_attacks(source_sq, position.whole_board) & targets)
+                    return true;
+            }
+        }
+
+        // Slow path: check evasions, pinned pieces moving along the pin, and EP.
+        MoveVector moves;
+        generate_moves(moves, position, side);
+
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            Position test(position);
+            if (test.make_move(moves[i]))
+                return true;
+        }
+        return false;
     }
-}
\ No newline at end of file
+}
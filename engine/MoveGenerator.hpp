@@ -14,6 +14,38 @@ namespace chess
     void generate_bishop_moves(MoveVector &moves, const Position &position, Side side);
 	void generate_queen_moves(MoveVector &moves,  const Position &position, Side side);
 	void generate_all_moves(MoveVector &moves,    const Position &position,	Side side);
+
+    // For a side in check: king moves to squares that aren't attacked, and, against a single checker, moves that take it or
+    // block it. Other than the king moves, they may still leave the king in check through a pin, as with generate_all_moves.
+    void generate_evasions(MoveVector &moves, const Position &position, Side side);
+    // Moves that give check, direct or discovered, without taking anything or promoting. Castling is left out. They may
+    // leave the side's own king in check.
+    void generate_quiet_checks(MoveVector &moves, const Position &position, Side side);
+    // Whether the move, if legal, would put the enemy king in check. Much cheaper than making the move to find out.
+    bool gives_check(const Position &position, Move move);
+    // Whether the move, perhaps from another position, is one that generate_all_moves would produce here for the moving piece's
+    // side. Cheaper than generating the moves to look for it.
+    bool is_pseudo_legal(const Position &position, Move move);
+    // Whether a pseudo-legal move leaves its own king safe, i.e. whether make_move would accept it.
+    bool is_legal(const Position &position, Move move);
+    // The full move that a compact one stands for in the position, filling in the pieces from the board. Whatever the
+    // compact move, the result is something is_pseudo_legal can be asked about, which it should be if the move might be
+    // from another position, as with a hash table.
+    Move decode_move(const Position &position, Move16 move);
+    // The legal move for the side that coordinate text such as "e2e4", "e1g1" or "a7a8q" stands for, filled in the way the
+    // generator fills it in. An empty move if the text is malformed or names no legal move.
+    Move parse_coordinate_move(const Position &position, Side side, const char *text);
+    // generate_evasions if the side is in check, otherwise generate_all_moves. Either way, make_move still has the final word.
+    void generate_moves(MoveVector &moves, const Position &position, Side side);
+
+    // The same, for a side known at compile time, so that the per-side constants fold away. Instantiated for both sides.
+    template<Side Us> void generate_all_moves(MoveVector &moves, const Position &position);
+    template<Side Us> void generate_evasions(MoveVector &moves,  const Position &position);
+    template<Side Us> void generate_moves(MoveVector &moves,     const Position &position);
+
+    // Returns as soon as one legal move is found for the given side, so is much cheaper than generating everything
+    // and trial-making it, which is all that mate/stalemate detection needs.
+    bool has_any_legal_move(const Position &position, Side side);
 }
 
 #endif
@@ -0,0 +1,333 @@
+#include "Nnue.hpp"
+#include "Position.hpp"
+#include "BasicOperations.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+// Kernels are chosen at compile time. MSVC defines __AVX2__ under /arch:AVX2, but has no switch that implies SSE4.1,
+// so that has to be asked for explicitly with OINK_SSE41.
+#if defined(__AVX2__)
+    #define OINK_NNUE_AVX2
+    #include <immintrin.h>
+#elif defined(__SSE4_1__) || defined(OINK_SSE41)
+    #define OINK_NNUE_SSE41
+    #include <immintrin.h>
+#endif
+
+namespace chess
+{
+namespace nnue
+{
+    struct Network
+    {
+        alignas(32) int16_t feature_weights[NNUE_INPUTS][NNUE_HIDDEN];  // 192k
+        alignas(32) int16_t feature_biases[NNUE_HIDDEN];
+        alignas(32) int8_t  output_weights[2 * NNUE_HIDDEN];
+        int32_t             output_bias;
+    };
+
+    static Network network;
+    static bool    loaded = false;
+
+    static const char     MAGIC[8] = { 'O', 'I', 'N', 'K', 'N', 'N', 'U', 'E' };
+    static const uint32_t VERSION  = 1;
+
+    // Indexed by a move's castling field.
+    static const Square CASTLING_ROOK_SOURCE[]      = { squares::NO_SQUARE, squares::h1, squares::a1, squares::h8, squares::a8 };
+    static const Square CASTLING_ROOK_DESTINATION[] = { squares::NO_SQUARE, squares::f1, squares::d1, squares::f8, squares::d8 };
+
+    // Each side sees the board as if it were white: own pieces first, and the board flipped for black.
+    static OINK_INLINE int feature_index(Side perspective, Piece piece, Square square)
+    {
+        int type            = (piece - 1) >> 1; // Pawn, king, rook, knight, bishop, queen
+        int relative_colour = get_piece_side(piece) != perspective;
+        int relative_square = perspective == sides::white ? square : square ^ 56;
+        return (relative_colour * 6 + type) * util::NUM_SQUARES + relative_square;
+    }
+
+    static OINK_INLINE const int16_t *feature_column(Side perspective, Piece piece, Square square)
+    {
+        return network.feature_weights[feature_index(perspective, piece, square)];
+    }
+
+    //==================================== Kernels ====================================
+
+    // out = in + the added columns - the subtracted ones. out may be the same as in.
+    static OINK_INLINE void apply_columns_scalar(int16_t *out, const int16_t *in, const int16_t *const *adds, int num_adds,
+                                                 const int16_t *const *subs, int num_subs)
+    {
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            int16_t value = in[i];
+            for (int a = 0; a < num_adds; ++a)
+                value += adds[a][i];
+            for (int s = 0; s < num_subs; ++s)
+                value -= subs[s][i];
+            out[i] = value;
+        }
+    }
+
+    // Sum over the neurons of clamp(acc, 0, QA) * weight.
+    static OINK_INLINE int32_t crelu_dot_scalar(const int16_t *acc, const int8_t *weights)
+    {
+        int32_t sum = 0;
+        for (int i = 0; i < NNUE_HIDDEN; ++i)
+        {
+            int32_t activation = acc[i] < 0 ? 0 : acc[i] > QA ? QA : acc[i];
+            sum += activation * weights[i];
+        }
+        return sum;
+    }
+
+    static OINK_INLINE void apply_columns(int16_t *out, const int16_t *in, const int16_t *const *adds, int num_adds,
+                                          const int16_t *const *subs, int num_subs)
+    {
+#if defined(OINK_NNUE_AVX2)
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i value = _mm256_load_si256((const __m256i *)(in + i));
+            for (int a = 0; a < num_adds; ++a)
+                value = _mm256_add_epi16(value, _mm256_load_si256((const __m256i *)(adds[a] + i)));
+            for (int s = 0; s < num_subs; ++s)
+                value = _mm256_sub_epi16(value, _mm256_load_si256((const __m256i *)(subs[s] + i)));
+            _mm256_store_si256((__m256i *)(out + i), value);
+        }
+#elif defined(OINK_NNUE_SSE41)
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i value = _mm_load_si128((const __m128i *)(in + i));
+            for (int a = 0; a < num_adds; ++a)
+                value = _mm_add_epi16(value, _mm_load_si128((const __m128i *)(adds[a] + i)));
+            for (int s = 0; s < num_subs; ++s)
+                value = _mm_sub_epi16(value, _mm_load_si128((const __m128i *)(subs[s] + i)));
+            _mm_store_si128((__m128i *)(out + i), value);
+        }
+#else
+        apply_columns_scalar(out, in, adds, num_adds, subs, num_subs);
+#endif
+    }
+
+    static OINK_INLINE int32_t crelu_dot(const int16_t *acc, const int8_t *weights)
+    {
+#if defined(OINK_NNUE_AVX2)
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i qa   = _mm256_set1_epi16(QA);
+        __m256i sum = zero;
+        for (int i = 0; i < NNUE_HIDDEN; i += 16)
+        {
+            __m256i activation = _mm256_min_epi16(_mm256_max_epi16(_mm256_load_si256((const __m256i *)(acc + i)), zero), qa);
+            __m256i weight     = _mm256_cvtepi8_epi16(_mm_load_si128((const __m128i *)(weights + i)));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(activation, weight));
+        }
+        __m128i sum128 = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0x4e));
+        sum128 = _mm_add_epi32(sum128, _mm_shuffle_epi32(sum128, 0xb1));
+        return _mm_cvtsi128_si32(sum128);
+#elif defined(OINK_NNUE_SSE41)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i qa   = _mm_set1_epi16(QA);
+        __m128i sum = zero;
+        for (int i = 0; i < NNUE_HIDDEN; i += 8)
+        {
+            __m128i activation = _mm_min_epi16(_mm_max_epi16(_mm_load_si128((const __m128i *)(acc + i)), zero), qa);
+            __m128i weight     = _mm_cvtepi8_epi16(_mm_loadl_epi64((const __m128i *)(weights + i)));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(activation, weight));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4e));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xb1));
+        return _mm_cvtsi128_si32(sum);
+#else
+        return crelu_dot_scalar(acc, weights);
+#endif
+    }
+
+    const char *kernel_name()
+    {
+#if defined(OINK_NNUE_AVX2)
+        return "AVX2";
+#elif defined(OINK_NNUE_SSE41)
+        return "SSE4.1";
+#else
+        return "scalar";
+#endif
+    }
+
+    //================================== Accumulators ==================================
+
+    template<typename ApplyColumns>
+    static OINK_INLINE void refresh_with(Accumulator &accumulator, const Position &pos, ApplyColumns apply)
+    {
+        for (Side perspective = sides::white; perspective <= sides::black; ++perspective)
+        {
+            int16_t *values = accumulator.values[perspective];
+            memcpy(values, network.feature_biases, sizeof(network.feature_biases));
+
+            Square square;
+            for (Bitboard b = pos.whole_board; b; )
+            {
+                b = get_and_clear_first_occ_square(b, &square);
+                const int16_t *column = feature_column(perspective, pos.squares[square], square);
+                apply(values, values, &column, 1, nullptr, 0);
+            }
+        }
+    }
+
+    void Accumulator::refresh(const Position &pos)
+    {
+        refresh_with(*this, pos, apply_columns);
+    }
+
+    void refresh_scalar(Accumulator &accumulator, const Position &pos)
+    {
+        refresh_with(accumulator, pos, apply_columns_scalar);
+    }
+
+    void Accumulator::update(const Accumulator &parent, Move move)
+    {
+        const Piece  piece       = move.get_piece();
+        const Side   side        = get_piece_side(piece);
+        const Square source      = move.get_source();
+        const Square dest        = move.get_destination();
+        const Piece  captured    = move.get_captured_piece();
+        const Piece  promotion   = move.get_promotion_piece();
+        const unsigned char castling = move.get_castling();
+
+        // At most two pieces appear (the mover, and a castling rook) and two disappear (the mover and whatever it took,
+        // or the mover and the castling rook).
+        Piece  added[2],   removed[2];
+        Square added_at[2], removed_at[2];
+        int    num_added = 0, num_removed = 0;
+
+        removed[num_removed] = piece;
+        removed_at[num_removed++] = source;
+        added[num_added] = promotion != pieces::NONE ? promotion : piece;
+        added_at[num_added++] = dest;
+
+        if (captured != pieces::NONE)
+        {
+            removed[num_removed] = captured;
+            removed_at[num_removed++] = move.get_en_passant() != pieces::NONE ? dest - sides::NEXT_RANK_OFFSET[side] : dest;
+        }
+        else if (castling != moves::CASTLING_NONE)
+        {
+            removed[num_removed] = pieces::ROOKS[side];
+            removed_at[num_removed++] = CASTLING_ROOK_SOURCE[castling];
+            added[num_added] = pieces::ROOKS[side];
+            added_at[num_added++] = CASTLING_ROOK_DESTINATION[castling];
+        }
+
+        for (Side perspective = sides::white; perspective <= sides::black; ++perspective)
+        {
+            const int16_t *adds[2], *subs[2];
+            for (int i = 0; i < num_added; ++i)
+                adds[i] = feature_column(perspective, added[i], added_at[i]);
+            for (int i = 0; i < num_removed; ++i)
+                subs[i] = feature_column(perspective, removed[i], removed_at[i]);
+
+            apply_columns(values[perspective], parent.values[perspective], adds, num_added, subs, num_removed);
+        }
+    }
+
+    //=================================== Evaluation ===================================
+
+    static OINK_INLINE PosEvaluation scale_output(int32_t output)
+    {
+        return (PosEvaluation)((int64_t)output * SCALE / (QA * QB));
+    }
+
+    PosEvaluation evaluate(const Accumulator &accumulator, Side side_to_move)
+    {
+        int32_t output = network.output_bias +
+                         crelu_dot(accumulator.values[side_to_move],            network.output_weights) +
+                         crelu_dot(accumulator.values[swap_side(side_to_move)], network.output_weights + NNUE_HIDDEN);
+        return scale_output(output);
+    }
+
+    PosEvaluation evaluate_scalar(const Accumulator &accumulator, Side side_to_move)
+    {
+        int32_t output = network.output_bias +
+                         crelu_dot_scalar(accumulator.values[side_to_move],            network.output_weights) +
+                         crelu_dot_scalar(accumulator.values[swap_side(side_to_move)], network.output_weights + NNUE_HIDDEN);
+        return scale_output(output);
+    }
+
+    //================================= Weights files =================================
+
+    // The file is read straight into memory, so this assumes a little-endian machine.
+    bool load_network(const char *path)
+    {
+        FILE *file = fopen(path, "rb");
+        if (!file)
+            return false;
+
+        char     magic[sizeof(MAGIC)];
+        uint32_t version = 0, hidden = 0;
+        bool ok = fread(magic, sizeof(magic), 1, file) == 1 &&
+                  memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                  fread(&version, sizeof(version), 1, file) == 1 && version == VERSION &&
+                  fread(&hidden, sizeof(hidden), 1, file) == 1 && hidden == NNUE_HIDDEN;
+
+        // Don't leave a half-loaded network behind.
+        static Network incoming;
+        ok = ok &&
+             fread(incoming.feature_weights, sizeof(incoming.feature_weights), 1, file) == 1 &&
+             fread(incoming.feature_biases,  sizeof(incoming.feature_biases),  1, file) == 1 &&
+             fread(incoming.output_weights,  sizeof(incoming.output_weights),  1, file) == 1 &&
+             fread(&incoming.output_bias,    sizeof(incoming.output_bias),     1, file) == 1;
+        fclose(file);
+
+        if (ok)
+        {
+            network = incoming;
+            loaded  = true;
+        }
+        return ok;
+    }
+
+    bool save_network(const char *path)
+    {
+        FILE *file = fopen(path, "wb");
+        if (!file)
+            return false;
+
+        uint32_t version = VERSION, hidden = NNUE_HIDDEN;
+        bool ok = fwrite(MAGIC, sizeof(MAGIC), 1, file) == 1 &&
+                  fwrite(&version, sizeof(version), 1, file) == 1 &&
+                  fwrite(&hidden, sizeof(hidden), 1, file) == 1 &&
+                  fwrite(network.feature_weights, sizeof(network.feature_weights), 1, file) == 1 &&
+                  fwrite(network.feature_biases,  sizeof(network.feature_biases),  1, file) == 1 &&
+                  fwrite(network.output_weights,  sizeof(network.output_weights),  1, file) == 1 &&
+                  fwrite(&network.output_bias,    sizeof(network.output_bias),     1, file) == 1;
+        return fclose(file) == 0 && ok;
+    }
+
+    void init_random_network(uint64_t seed)
+    {
+        std::mt19937_64 rand_engine(seed);
+        // Small enough that no sum of 32 columns can overflow an int16.
+        std::uniform_int_distribution<int> feature_weight(-32, 32);
+        std::uniform_int_distribution<int> feature_bias(0, 64);
+        std::uniform_int_distribution<int> output_weight(-64, 64);
+
+        for (int input = 0; input < NNUE_INPUTS; ++input)
+            for (int neuron = 0; neuron < NNUE_HIDDEN; ++neuron)
+                network.feature_weights[input][neuron] = (int16_t)feature_weight(rand_engine);
+
+        for (int neuron = 0; neuron < NNUE_HIDDEN; ++neuron)
+            network.feature_biases[neuron] = (int16_t)feature_bias(rand_engine);
+
+        for (int neuron = 0; neuron < 2 * NNUE_HIDDEN; ++neuron)
+            network.output_weights[neuron] = (int8_t)output_weight(rand_engine);
+
+        network.output_bias = 0;
+        loaded = true;
+    }
+
+    bool network_loaded()
+    {
+        return loaded;
+    }
+}
+}
@@ -0,0 +1,70 @@
+#ifndef NNUE_HPP
+#define NNUE_HPP
+
+#include "BasicTypes.hpp"
+#include "ChessConstants.hpp"
+#include "Move.hpp"
+
+#include <cstdint>
+
+namespace chess
+{
+    class Position;
+
+    // A small efficiently-updatable neural network evaluation, as an alternative to eval_position().
+    //
+    // Architecture: 768 inputs (6 piece types x 2 colours x 64 squares), seen from each side's point of view, feed a hidden
+    // layer of NNUE_HIDDEN int16 neurons per side. Both halves, the side to move's first, go through a clipped ReLU into a
+    // single int8-weighted output.
+    //
+    // The hidden layer before activation (the accumulator) is a sum of one weight column per piece on the board, so a move
+    // only has to add and subtract a few columns. Accumulators are kept alongside the Positions on the search stack, each
+    // one derived from its parent's, so backing up the search needs no undo.
+    namespace nnue
+    {
+        const int NNUE_INPUTS = 768;
+        const int NNUE_HIDDEN = 128;
+
+        // Quantisation: activations are clipped to [0, QA], output weights are scaled by QB, and the output is
+        // scaled by SCALE to give centipawns.
+        const int QA    = 255;
+        const int QB    = 64;
+        const int SCALE = 400;
+
+        struct Accumulator
+        {
+            alignas(32) int16_t values[2][NNUE_HIDDEN];  // [perspective][neuron]
+
+            // From scratch.
+            void refresh(const Position &pos);
+            // This accumulator becomes the parent's updated for the move, which must have been legal in the parent.
+            void update(const Accumulator &parent, Move move);
+        };
+
+        // Weights file layout, all little-endian:
+        //   char     magic[8]        "OINKNNUE"
+        //   uint32_t version         1
+        //   uint32_t hidden          must match NNUE_HIDDEN
+        //   int16_t  feature_weights[NNUE_INPUTS][NNUE_HIDDEN]
+        //   int16_t  feature_biases[NNUE_HIDDEN]
+        //   int8_t   output_weights[2 * NNUE_HIDDEN]   side to move's half first
+        //   int32_t  output_bias
+        bool load_network(const char *path);
+        bool save_network(const char *path);
+        // Random but sane weights, for tests and benchmarks.
+        void init_random_network(uint64_t seed);
+        bool network_loaded();
+
+        // From POV of side to move.
+        PosEvaluation evaluate(const Accumulator &accumulator, Side side_to_move);
+
+        // The same, using only plain C++, for checking the vectorised kernels against.
+        PosEvaluation evaluate_scalar(const Accumulator &accumulator, Side side_to_move);
+        void refresh_scalar(Accumulator &accumulator, const Position &pos);
+
+        // Which kernels were compiled in: "AVX2", "SSE4.1" or "scalar".
+        const char *kernel_name();
+    }
+}
+
+#endif // NNUE_HPP
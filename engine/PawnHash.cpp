@@ -0,0 +1,132 @@
+#include "PawnHash.hpp"
+#include "Position.hpp"
+#include "BasicOperations.hpp"
+#include "EvalTrace.hpp"
+
+#include <cassert>
+#include <algorithm>
+
+namespace chess
+{
+    static OINK_INLINE RankFile relative_rank(Square square, Side side)
+    {
+        return side == sides::white ? square_to_rank(square) : ranks::eighth - square_to_rank(square);
+    }
+
+    // Pawn structure terms for one side, from that side's point of view.
+    // Most of these are done set-wise; only passed pawns and candidates, of which there are few, are looked at one by one.
+    template<typename Trace>
+    static Score evaluate_side_pawns(Side side, Bitboard own, Bitboard enemy, PawnEntry &entry, Trace &trace)
+    {
+        const Side other = swap_side(side);
+        Score score = 0;
+        Square square;
+
+        // No enemy pawns in front, on this file or either side.
+        Bitboard passed = own & ~(front_span(enemy, other) | pawn_attack_span(enemy, other));
+
+        // No own pawns on either neighbouring file.
+        Bitboard own_files = fill_files(own);
+        Bitboard isolated  = own & ~(shift_east(own_files) | shift_west(own_files));
+
+        // Pawns with another of their own in front of them: only the rearmost of a pair is counted.
+        Bitboard doubled = own & front_span(own, other);
+
+        // Can't advance without being taken by a pawn, and no neighbouring pawn further back that could come up to defend it.
+        // Isolated pawns already have their own penalty.
+        Bitboard stops    = shift_forward(own, side);
+        Bitboard backward = shift_forward(stops & all_pawn_attacks(enemy, other) & ~pawn_attack_span(own, side), other) & ~isolated;
+
+        score += count_bits(isolated) * evals::ISOLATED_PAWN_PENALTY;
+        score += count_bits(doubled)  * evals::DOUBLED_PAWN_PENALTY;
+        score += count_bits(backward) * evals::BACKWARD_PAWN_PENALTY;
+        trace.add(eval_terms::ISOLATED_PAWN, side, count_bits(isolated));
+        trace.add(eval_terms::DOUBLED_PAWN,  side, count_bits(doubled));
+        trace.add(eval_terms::BACKWARD_PAWN, side, count_bits(backward));
+
+        for (Bitboard b = passed; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            score += evals::PASSED_PAWN_BONUS[relative_rank(square, side)];
+            trace.add(eval_terms::PASSED_PAWN + relative_rank(square, side), side, 1);
+        }
+
+        // Candidates: not passed, but nothing in front on the pawn's own file, and at least as many friendly pawns alongside
+        // or behind on the neighbouring files (which can support it as it advances) as there are enemy ones ahead to stop it.
+        for (Bitboard b = own & ~passed & ~front_span(enemy, other); b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+
+            Bitboard pawn     = util::one << square;
+            Bitboard behind   = front_span(pawn, other) | pawn;
+            Bitboard helpers  = own & (shift_east(behind) | shift_west(behind));
+            Bitboard sentries = enemy & pawn_attack_span(pawn, side);
+
+            if (count_bits(helpers) >= count_bits(sentries))
+            {
+                score += evals::CANDIDATE_PASSER_BONUS[relative_rank(square, side)];
+                trace.add(eval_terms::CANDIDATE_PASSER + relative_rank(square, side), side, 1);
+            }
+        }
+
+        entry.passed[side]       = passed;
+        entry.attacks[side]      = all_pawn_attacks(own, side);
+        entry.attack_spans[side] = pawn_attack_span(own, side);
+
+        return score;
+    }
+
+    template<typename Trace>
+    static void evaluate_pawns(const Position &pos, PawnEntry &entry, Trace &trace)
+    {
+        const Bitboard white_pawns = pos.pawns[sides::white];
+        const Bitboard black_pawns = pos.pawns[sides::black];
+
+        entry.score = evaluate_side_pawns(sides::white, white_pawns, black_pawns, entry, trace)
+                    - evaluate_side_pawns(sides::black, black_pawns, white_pawns, entry, trace);
+    }
+
+    void evaluate_pawns(const Position &pos, PawnEntry &entry)
+    {
+        NoTrace no_trace;
+        evaluate_pawns(pos, entry, no_trace);
+    }
+
+    void trace_pawns(const Position &pos, PawnEntry &entry, EvalTrace &trace)
+    {
+        evaluate_pawns(pos, entry, trace);
+    }
+
+    PawnHashTable::PawnHashTable(size_t num_entries) :
+        entries(num_entries),
+        index_mask(num_entries - 1)
+    {
+        assert((num_entries & (num_entries - 1)) == 0);
+        clear();
+    }
+
+    void PawnHashTable::clear()
+    {
+        // Zeroed entries are valid: key 0 is the key for no pawns, where everything in the entry is zero too.
+        PawnEntry empty = {};
+        std::fill(entries.begin(), entries.end(), empty);
+        probes = 0;
+        hits   = 0;
+    }
+
+    const PawnEntry &PawnHashTable::probe(const Position &pos)
+    {
+        ++probes;
+
+        PawnEntry &entry = entries[pos.pawn_key & index_mask];
+        if (entry.key == pos.pawn_key)
+        {
+            ++hits;
+            return entry;
+        }
+
+        evaluate_pawns(pos, entry);
+        entry.key = pos.pawn_key;
+        return entry;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef PAWNHASH_HPP
+#define PAWNHASH_HPP
+
+#include "BasicTypes.hpp"
+#include "ChessConstants.hpp"
+
+#include <cstddef>
+#include <vector>
+
+namespace chess
+{
+    class Position;
+    struct EvalTrace;
+
+    // Everything the evaluator wants to know that depends on the pawns alone, so can be cached under Position::pawn_key.
+    struct PawnEntry
+    {
+        HashKey  key;
+        Score    score;           // Passed, candidate, isolated, doubled and backward pawns. Positive is good for white.
+        Bitboard passed[2];
+        Bitboard attacks[2];      // Squares attacked by each side's pawns
+        Bitboard attack_spans[2]; // Squares each side's pawns attack now or could do after advancing
+    };
+
+    // Full calculation of everything in the entry except the key.
+    void evaluate_pawns(const Position &pos, PawnEntry &entry);
+    // The same, also adding the terms that make up the score to the trace.
+    void trace_pawns(const Position &pos, PawnEntry &entry, EvalTrace &trace);
+
+    class PawnHashTable
+    {
+        std::vector<PawnEntry> entries;
+        HashKey                index_mask;
+    public:
+        uint64_t probes;
+        uint64_t hits;
+
+        // num_entries must be a power of two.
+        explicit PawnHashTable(size_t num_entries);
+
+        void clear();
+
+        // Returns the entry for the position's pawns, evaluating them (and replacing whatever was there) on a miss.
+        const PawnEntry &probe(const Position &pos);
+    };
+}
+
+#endif // PAWNHASH_HPP
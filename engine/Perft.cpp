@@ -5,29 +5,37 @@
 
 namespace chess
 {
-    uint64_t perft_nodesonly(int depth, Position &pos, Side side)
+    // The side is a template parameter, so that generation and make_move are picked once at the root rather than at every node.
+    template<Side Us>
+    static uint64_t perft_nodesonly_inner(int depth, Position &pos)
     {
         if (depth == 0)
             return 1;
 
         MoveVector moves;
-        generate_all_moves(moves, pos, side);
+        generate_moves<Us>(moves, pos);
 
         uint64_t leaves = 0;
         Position backup(pos);
 
         for (uint32_t i = 0; i < moves.size; ++i)
         {
-            if (pos.make_move(moves[i]))
+            if (pos.make_move<Us>(moves[i]))
             {
-                leaves += perft_nodesonly(depth - 1, pos, swap_side(side));
+                leaves += perft_nodesonly_inner<SideConstants<Us>::them>(depth - 1, pos);
             }
             pos = backup; // undo move
         }
         return leaves;
     }
 
-    static void perft_correctness_inner(int depth, Position &pos, Side side, DetailedPerftResults &results)
+    uint64_t perft_nodesonly(int depth, Position &pos, Side side)
+    {
+        return side == sides::white ? perft_nodesonly_inner<sides::white>(depth, pos) : perft_nodesonly_inner<sides::black>(depth, pos);
+    }
+
+    template<Side Us>
+    static void perft_correctness_inner(int depth, Position &pos, DetailedPerftResults &results)
     {
         uint64_t leaves = 0;
  
@@ -38,32 +46,32 @@ namespace chess
         }
 
         MoveVector moves;
-        generate_all_moves(moves, pos, side);
+        generate_moves<Us>(moves, pos);
         bool any = false;
         Position backup(pos);
 
         for (uint32_t i = 0; i < moves.size; ++i)
         {
-            if (pos.make_move(moves[i]))
+            if (pos.make_move<Us>(moves[i]))
             {
                 any = true;
 
                 if (depth == 1)
                 {
-                    auto pos_type = test_position_type(pos, swap_side(side));
                     if (moves[i].get_captured_piece() != pieces::NONE)  ++results.capture_count;
                     if (moves[i].get_castling() != moves::CASTLING_NONE)++results.castle_count;
                     if (moves[i].get_promotion_piece() != pieces::NONE) ++results.prom_count;
                     if (moves[i].get_en_passant() != pieces::NONE)      ++results.ep_count;
-                    if (pos_type == util::CHECK)                        ++results.check_count;
-                    if (pos_type == util::MATE)
+                    // Only a check can be mate, so the reply search is only needed then.
+                    if (gives_check(backup, moves[i]))
                     {
-                        ++results.mate_count;
                         ++results.check_count;
+                        if (!has_any_legal_move(pos, SideConstants<Us>::them))
+                            ++results.mate_count;
                     }
                 }
 
-                perft_correctness_inner(depth - 1, pos, swap_side(side), results);
+                perft_correctness_inner<SideConstants<Us>::them>(depth - 1, pos, results);
             }
             pos = backup; // undo move
         }
@@ -73,7 +81,10 @@ namespace chess
     {
         DetailedPerftResults results;
         memset(&results, 0, sizeof(results));
-        perft_correctness_inner(depth, pos, side, results);
+        if (side == sides::white)
+            perft_correctness_inner<sides::white>(depth, pos, results);
+        else
+            perft_correctness_inner<sides::black>(depth, pos, results);
         return results;
     }
 }
@@ -2,6 +2,9 @@
 
 #include <cstdlib>
 
+// Verify the incrementally-updated evaluation terms against a full recalculation after every move. Slow!
+//#define OINK_CHECK_INCREMENTAL_EVAL
+
 namespace chess
 {
 	Position::Position()
@@ -19,6 +22,14 @@ namespace chess
         ep_target_square = squares::NO_SQUARE;
         fifty_move_count = 0;
         material         = 0;
+        psq              = 0;
+        pawn_key         = 0;
+        material_key     = 0;
+        hash_key         = 0;
+        state.valid      = 0;
+#ifdef OINK_INCREMENTAL_ATTACKS
+        compute_attack_tables();
+#endif
 	}
 
 	void Position::setup_starting_position()
@@ -69,7 +80,150 @@ namespace chess
 		squares[squares::f8] = pieces::BLACK_BISHOP;
 		squares[squares::g8] = pieces::BLACK_KNIGHT;
 		squares[squares::h8] = pieces::BLACK_ROOK;
+
+        recompute_incremental_evals();
 	}
+
+    void Position::compute_incremental_evals(Score &psq_out) const
+    {
+        psq_out = 0;
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            psq_out += evals::piece_square[squares[square]][square];
+    }
+
+    PosEvaluation Position::compute_material() const
+    {
+        PosEvaluation total = 0;
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            total -= evals::PIECE_CAPTURE_VALUES[squares[square]];
+        return total;
+    }
+
+    HashKey Position::compute_pawn_key() const
+    {
+        HashKey key = 0;
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            key ^= zobrist::pawn_square[squares[square]][square];
+        return key;
+    }
+
+    HashKey Position::compute_material_key() const
+    {
+        HashKey key = 0;
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            key += material_keys::UNITS[squares[square]];
+        return key;
+    }
+
+    HashKey Position::compute_hash_key() const
+    {
+        HashKey key = zobrist::castling[castling_rights] ^ zobrist::en_passant[ep_target_square];
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+            key ^= zobrist::piece_square[squares[square]][square];
+        return key;
+    }
+
+#ifdef OINK_INCREMENTAL_ATTACKS
+    static OINK_INLINE Bitboard piece_attacks(Piece piece, Square square, Bitboard occupancy)
+    {
+        switch (piece)
+        {
+        case pieces::WHITE_PAWN:   return moves::pawn_captures[sides::white][square];
+        case pieces::BLACK_PAWN:   return moves::pawn_captures[sides::black][square];
+        case pieces::WHITE_KING:
+        case pieces::BLACK_KING:   return moves::king_moves[square];
+        case pieces::WHITE_ROOK:
+        case pieces::BLACK_ROOK:   return rank_file_attacks(square, occupancy);
+        case pieces::WHITE_KNIGHT:
+        case pieces::BLACK_KNIGHT: return moves::knight_moves[square];
+        case pieces::WHITE_BISHOP:
+        case pieces::BLACK_BISHOP: return diagonal_attacks(square, occupancy);
+        case pieces::WHITE_QUEEN:
+        case pieces::BLACK_QUEEN:  return rank_file_attacks(square, occupancy) | diagonal_attacks(square, occupancy);
+        default:                   return util::nil;
+        }
+    }
+
+    void Position::compute_attack_tables()
+    {
+        memset(attacks_to, 0, sizeof(attacks_to));
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+        {
+            attacks_from[square] = piece_attacks(squares[square], square, whole_board);
+
+            Square target;
+            for (Bitboard b = attacks_from[square]; b; )
+            {
+                b = get_and_clear_first_occ_square(b, &target);
+                attacks_to[target] |= squarebits::indexed[square];
+            }
+        }
+    }
+
+    bool Position::attack_tables_consistent() const
+    {
+        Position full(*this);
+        full.compute_attack_tables();
+        return memcmp(full.attacks_from, attacks_from, sizeof(attacks_from)) == 0 &&
+               memcmp(full.attacks_to,   attacks_to,   sizeof(attacks_to))   == 0;
+    }
+
+    // Brings the tables up to date after the pieces on the changed squares have come or gone. Those pieces' own attacks change,
+    // as do those of any slider whose line runs through one of the squares: which is to say any slider attacking it.
+    void Position::update_attack_tables(Bitboard changed)
+    {
+        const Bitboard sliders = rooks[sides::white] | rooks[sides::black] | bishops[sides::white] | bishops[sides::black] |
+                                 queens[sides::white] | queens[sides::black];
+
+        Bitboard to_update = changed;
+        Square square;
+        for (Bitboard b = changed; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            to_update |= attacks_to[square] & sliders;
+        }
+
+        while (to_update)
+        {
+            to_update = get_and_clear_first_occ_square(to_update, &square);
+
+            Bitboard attacks = piece_attacks(squares[square], square, whole_board);
+            Bitboard lost    = attacks_from[square] & ~attacks;
+            Bitboard gained  = attacks & ~attacks_from[square];
+            attacks_from[square] = attacks;
+
+            Square target;
+            while (lost)
+            {
+                lost = get_and_clear_first_occ_square(lost, &target);
+                attacks_to[target] &= ~squarebits::indexed[square];
+            }
+            while (gained)
+            {
+                gained = get_and_clear_first_occ_square(gained, &target);
+                attacks_to[target] |= squarebits::indexed[square];
+            }
+        }
+    }
+
+    // The rook's squares, indexed by moves::CASTLING_...
+    static const Bitboard CASTLING_ROOK_SQUARES[] =
+    {
+        util::nil, squarebits::h1 | squarebits::f1, squarebits::a1 | squarebits::d1, squarebits::h8 | squarebits::f8, squarebits::a8 | squarebits::d8
+    };
+#endif
+
+    void Position::recompute_incremental_evals()
+    {
+        compute_incremental_evals(psq);
+        material     = compute_material();
+        pawn_key     = compute_pawn_key();
+        material_key = compute_material_key();
+        hash_key     = compute_hash_key();
+#ifdef OINK_INCREMENTAL_ATTACKS
+        compute_attack_tables();
+#endif
+    }
 	
 	Bitboard Position::generate_side(Side side) const
     {
@@ -86,54 +240,57 @@ namespace chess
 		sides[sides::white] = generate_side(sides::white);
 		sides[sides::black] = generate_side(sides::black);
 		whole_board = sides[sides::white] | sides[sides::black];
+        state.valid = 0;
+#ifdef OINK_INCREMENTAL_ATTACKS
+        compute_attack_tables();
+#endif
 
         // OINK_TODO: material!
 	}
 
-    void Position::move_common_first_stage(Piece moving_piece, Side side, Square source, Square dest, Bitboard source_and_dest_bitboard)
+    // Takes a piece off one square and puts it on another, which must be empty, updating everything but the castling rights,
+    // EP square and fifty-move count. Pawns' moves go into the pawn key through the table, which is zero for other pieces.
+    OINK_INLINE void Position::move_piece(Piece piece, Side side, Square source, Square dest)
     {
-        piece_bbs[moving_piece]  ^= source_and_dest_bitboard;
-        sides[side]              ^= source_and_dest_bitboard;
-        squares[source]           = pieces::NONE;
-        squares[dest]             = moving_piece;
-        ep_target_square          = squares::NO_SQUARE;
+        const Bitboard source_and_dest_bitboard = (util::one << source) | (util::one << dest);
+
+        piece_bbs[piece]  ^= source_and_dest_bitboard;
+        sides[side]       ^= source_and_dest_bitboard;
+        whole_board       ^= source_and_dest_bitboard;
+        squares[source]    = pieces::NONE;
+        squares[dest]      = piece;
+        remove_piece_square_score(piece, source);
+        add_piece_square_score(piece, dest);
+        pawn_key ^= zobrist::pawn_square[piece][source] ^ zobrist::pawn_square[piece][dest];
+        hash_key ^= zobrist::piece_square[piece][source] ^ zobrist::piece_square[piece][dest];
     }
 
-    static OINK_INLINE Bitboard make_castling_mask(Bitboard input)
+    OINK_INLINE void Position::remove_captured_piece(Piece piece, Side side, Square where)
     {
-        Bitboard mask;
-        // Shift the set bit, if any, down to the right position.
-        mask  = (input & squarebits::h1) >> 7;  /* CASTLING_RIGHTS_WHITE_KINGSIDE  == 0x1 */
-        mask |= (input & squarebits::a1) << 1;  /* CASTLING_RIGHTS_WHITE_QUEENSIDE == 0x2 */
-        mask |= (input & squarebits::h8) >> 61; /* CASTLING_RIGHTS_BLACK_KINGSIDE  == 0x4 */
-        mask |= (input & squarebits::a8) >> 53; /* CASTLING_RIGHTS_BLACK_QUEENSIDE == 0x8 */
-
-        return mask;
+        const Bitboard where_bitboard = util::one << where;
+
+        piece_bbs[piece] ^= where_bitboard;
+        sides[side]      ^= where_bitboard;
+        whole_board      ^= where_bitboard;
+        squares[where]    = pieces::NONE;
+        // e.g. if white's moving, then material goes up by the value of the piece he captured (positive)
+        material += evals::PIECE_CAPTURE_VALUES[piece];
+        remove_piece_square_score(piece, where);
+        pawn_key ^= zobrist::pawn_square[piece][where];
+        material_key -= material_keys::UNITS[piece];
+        hash_key ^= zobrist::piece_square[piece][where];
     }
 
-    void Position::move_common_second_stage(Piece captured_piece, Side side_capturing, Bitboard dest_bitboard, Bitboard source_bitboard, Bitboard source_and_dest_bitboard)
+    bool Position::square_attacked(Square square, Side side_on_square) const
     {
-        if (captured_piece != pieces::NONE)
-        {
-            piece_bbs[captured_piece]           ^= dest_bitboard;
-            sides[swap_side(side_capturing)]    ^= dest_bitboard;
-            whole_board                         ^= source_bitboard; // Not source_and_dest_bitboard, as dest is occupied before and after.
-            fifty_move_count = 0;
-            // e.g. if white's moving, then material goes up by the value of the piece he captured (positive)
-            material += evals::PIECE_CAPTURE_VALUES[captured_piece]; 
-
-            // Anything captured on the corner squares must remove castling rights, because either the rook has already moved, or we're capturing it.
-            // h1 => map to CASTLING_RIGHTS_WHITE_KINGSIDE, etc.
-            castling_rights &= ~make_castling_mask(dest_bitboard); // If the bits in the mask are set, this turns off the relevant bits.
-        }
-        else
-        {
-            whole_board ^= source_and_dest_bitboard;
-            ++fifty_move_count;
-        }
+#ifdef OINK_INCREMENTAL_ATTACKS
+        return (attacks_to[square] & sides[swap_side(side_on_square)]) != util::nil;
+#else
+        return square_attacked(square, side_on_square, whole_board);
+#endif
     }
 
-    bool Position::square_attacked(Square square, Side side_on_square) const
+    bool Position::square_attacked(Square square, Side side_on_square, Bitboard occupancy) const
     {
         RankFile rank, file;
         square_to_rank_file(square, rank, file);
@@ -152,186 +309,249 @@ namespace chess
 
         // Rank / file sliders: similar idea -- try to attack the other side's rooks.
         Bitboard attackers = queens[other_side] | rooks[other_side];
-        Bitboard rotated_occ = get_6bit_rank_occupancy(whole_board, rank);
+        Bitboard rotated_occ = get_6bit_rank_occupancy(occupancy, rank);
         if (attackers & moves::horiz_slider_moves[square][rotated_occ])
             return true;
 
-        rotated_occ = project_occupancy_from_file_to6bit(whole_board, file);
+        rotated_occ = project_occupancy_from_file_to6bit(occupancy, file);
         if (attackers & moves::vert_slider_moves[square][rotated_occ])
             return true;
 
         // Diagonal sliders
         attackers = queens[other_side] | bishops[other_side];
-        rotated_occ = project_occupancy_from_a1h8_to6bit(whole_board, rank, file);
+        rotated_occ = project_occupancy_from_a1h8_to6bit(occupancy, rank, file);
         if (attackers & moves::diag_moves_a1h8[square][rotated_occ])
             return true;
 
-        rotated_occ = project_occupancy_from_a8h1_to6bit(whole_board, rank, file);
+        rotated_occ = project_occupancy_from_a8h1_to6bit(occupancy, rank, file);
         if (attackers & moves::diag_moves_a8h1[square][rotated_occ])
             return true;
 
         return false;
     }
 
-    bool Position::detect_check(Side king_side) const
+    Bitboard Position::attackers_to(Square square, Bitboard occupancy) const
     {
-        Square king_square = get_first_occ_square(kings[king_side]);
-        return square_attacked(king_square, king_side);
+        return (pawns[sides::white] & moves::pawn_captures[sides::black][square]) |
+               (pawns[sides::black] & moves::pawn_captures[sides::white][square]) |
+               ((knights[sides::white] | knights[sides::black]) & moves::knight_moves[square]) |
+               ((kings[sides::white]   | kings[sides::black])   & moves::king_moves[square]) |
+               ((rooks[sides::white]   | rooks[sides::black]   | queens[sides::white] | queens[sides::black]) & rank_file_attacks(square, occupancy)) |
+               ((bishops[sides::white] | bishops[sides::black] | queens[sides::white] | queens[sides::black]) & diagonal_attacks(square, occupancy));
     }
 
-    bool Position::make_move(Move move)
+    bool Position::detect_check(Side king_side) const
     {
-        const Piece    moving_piece             = move.get_piece();
-        const Piece    captured_piece           = move.get_captured_piece();
-        const Square   source                   = move.get_source();
-        const Square   dest                     = move.get_destination();
-        const Side     side                     = get_piece_side(moving_piece);
-        const Bitboard source_bitboard          = util::one << source;
-        const Bitboard dest_bitboard            = util::one << dest;
-        const Bitboard source_and_dest_bitboard = source_bitboard | dest_bitboard;
-        unsigned char castling;
-
-        switch (moving_piece)
-        {
-        case pieces::WHITE_PAWN:
-        case pieces::BLACK_PAWN:
+        return checkers(king_side) != util::nil;
+    }
 
-            move_common_first_stage(moving_piece, side, source, dest, source_and_dest_bitboard);
+    void Position::compute_checkers(Side king_side) const
+    {
+#ifdef OINK_INCREMENTAL_ATTACKS
+        state.info.checkers[king_side] = attacks_to[get_first_occ_square(kings[king_side])] & sides[swap_side(king_side)];
+#else
+        state.info.checkers[king_side] = attackers_to(get_first_occ_square(kings[king_side]), whole_board) & sides[swap_side(king_side)];
+#endif
+        state.valid |= state_parts::CHECKERS[king_side];
+    }
 
-            // EP square is on third/sixth rank, if applicable:
-            ep_target_square = abs(square_to_rank(dest) - square_to_rank(source)) == 2 ? source + sides::NEXT_RANK_OFFSET[side] : squares::NO_SQUARE;
+    void Position::compute_pins() const
+    {
+        for (Side side = sides::white; side <= sides::black; ++side)
+        {
+            Side   other_side  = swap_side(side);
+            Square king_square = get_first_occ_square(kings[side]);
 
-            if (move.get_en_passant() != pieces::NONE)
-            {
-                Bitboard pawn_captured_ep_mask    = util::one << (dest - sides::NEXT_RANK_OFFSET[side]);  // the square below or above dest. Less shift for white, more for black
-                pawns[swap_side(side)]           ^= pawn_captured_ep_mask;
-                sides[swap_side(side)]           ^= pawn_captured_ep_mask;
-                squares[dest - sides::NEXT_RANK_OFFSET[side]] = pieces::NONE;
-                whole_board                      ^= (source_and_dest_bitboard | pawn_captured_ep_mask);
+            // Sliders that would hit the king on an empty board. Any with exactly one piece in the way pin it, if it's ours, or
+            // uncover check when it moves, if it's the enemy's.
+            Bitboard snipers = (rank_file_attacks(king_square, util::nil) & (rooks[other_side]   | queens[other_side])) |
+                               (diagonal_attacks(king_square, util::nil)  & (bishops[other_side] | queens[other_side]));
+            Bitboard blockers = util::nil;
 
-                material -= evals::PAWN_CAPTURE_VALUES[side];
-            }
-            else
+            Square sniper_square;
+            while (snipers)
             {
-                move_common_second_stage(captured_piece, side, dest_bitboard, source_bitboard, source_and_dest_bitboard);
-
-                Piece promotion_piece = move.get_promotion_piece();
-                if (promotion_piece != pieces::NONE)
-                {
-                    pawns[side]                 ^= dest_bitboard; // Turn back off pawn at dest
-                    piece_bbs[promotion_piece]  ^= dest_bitboard; // Turn on new piece at dest
-                    squares[dest]               = promotion_piece;
-
-                    material -= evals::PIECE_CAPTURE_VALUES[promotion_piece]; // "-=", as we're adding it
-                    material += evals::PAWN_CAPTURE_VALUES[side]; // we "lost" the pawn.
-                }
+                snipers = get_and_clear_first_occ_square(snipers, &sniper_square);
+                Bitboard in_between = between(king_square, sniper_square) & whole_board;
+                if (in_between && !(in_between & (in_between - 1)))
+                    blockers |= in_between;
             }
+            state.info.blockers[side] = blockers;
+        }
+        state.valid |= state_parts::PINS;
+    }
 
-            fifty_move_count = 0;
+    void Position::compute_check_squares() const
+    {
+        for (Side side = sides::white; side <= sides::black; ++side)
+        {
+            Square king_square = get_first_occ_square(kings[swap_side(side)]);
+            state.info.rank_file_checks[side] = rank_file_attacks(king_square, whole_board);
+            state.info.diagonal_checks[side]  = diagonal_attacks(king_square, whole_board);
+        }
+        state.valid |= state_parts::CHECK_SQUARES;
+    }
+
+    // Pawns, knights and kings set-wise, by shifting; sliders a piece at a time, from the tables. Or, with the incremental attack
+    // tables, the union of what's been kept for each piece.
+    void Position::compute_attacks(Side side) const
+    {
+        Bitboard *by_piece = state.info.attacks_by_piece;
+        Square square;
+
+#ifdef OINK_INCREMENTAL_ATTACKS
+        for (Piece piece = pieces::PAWNS[side]; piece <= pieces::QUEENS[side]; piece += 2)
+            by_piece[piece] = util::nil;
+        state.info.attacks_by_side[side] = util::nil;
+        for (Bitboard b = sides[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            by_piece[squares[square]]        |= attacks_from[square];
+            state.info.attacks_by_side[side] |= attacks_from[square];
+        }
+#else
+        by_piece[pieces::PAWNS[side]]   = all_pawn_attacks(pawns[side], side);
+        by_piece[pieces::KNIGHTS[side]] = all_knight_attacks(knights[side]);
+        by_piece[pieces::KINGS[side]]   = all_king_attacks(kings[side]);
+
+        by_piece[pieces::ROOKS[side]] = util::nil;
+        for (Bitboard b = rooks[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            by_piece[pieces::ROOKS[side]] |= rank_file_attacks(square, whole_board);
+        }
+
+        by_piece[pieces::BISHOPS[side]] = util::nil;
+        for (Bitboard b = bishops[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            by_piece[pieces::BISHOPS[side]] |= diagonal_attacks(square, whole_board);
+        }
 
+        by_piece[pieces::QUEENS[side]] = util::nil;
+        for (Bitboard b = queens[side]; b; )
+        {
+            b = get_and_clear_first_occ_square(b, &square);
+            by_piece[pieces::QUEENS[side]] |= rank_file_attacks(square, whole_board) | diagonal_attacks(square, whole_board);
+        }
+
+        state.info.attacks_by_side[side] = by_piece[pieces::PAWNS[side]] | by_piece[pieces::KNIGHTS[side]] | by_piece[pieces::KINGS[side]] |
+                                           by_piece[pieces::ROOKS[side]] | by_piece[pieces::BISHOPS[side]] | by_piece[pieces::QUEENS[side]];
+#endif
+        state.valid |= state_parts::ATTACKS[side];
+    }
+
+    // Dispatches on the move's type, so that quiet moves and captures, most of what's made, run straight through without
+    // asking about castling, EP or promotion. The castling rights go through the per-square table for every kind of move.
+    template<Side Us>
+    bool Position::make_move(Move move)
+    {
+        typedef SideConstants<Us> C;
+
+        const Piece  moving_piece   = move.get_piece();
+        const Piece  captured_piece = move.get_captured_piece();
+        const Square source         = move.get_source();
+        const Square dest           = move.get_destination();
+        // The castling rights and EP square can change in several places below; their hash keys are updated once, at the end.
+        const unsigned char old_castling_rights = castling_rights;
+        const Square        old_ep_target       = ep_target_square;
+        assert(get_piece_side(moving_piece) == Us);
+
+        switch (move.get_type())
+        {
+        case moves::MOVE_NORMAL:
+
+            move_piece(moving_piece, Us, source, dest);
+            // Only a pawn's double push can allow EP, and only a pawn move resets the count.
+            ep_target_square = moving_piece == C::pawn && dest - source == 2 * C::forward ? source + C::forward : squares::NO_SQUARE;
+            fifty_move_count = moving_piece == C::pawn ? 0 : fifty_move_count + 1;
             break;
 
-        case pieces::WHITE_KING:
-        case pieces::BLACK_KING:
+        case moves::MOVE_CAPTURE:
+
+            remove_captured_piece(captured_piece, C::them, dest);
+            move_piece(moving_piece, Us, source, dest);
+            ep_target_square = squares::NO_SQUARE;
+            fifty_move_count = 0;
+            break;
 
-            castling = move.get_castling();
-            switch (castling)
+        case moves::MOVE_PROMOTION:
             {
-            case moves::CASTLING_NONE:
-                break;
-            default:
-                assert(!captured_piece);
-                // Canna castle out of, or through, check
-                if (detect_check(side))
-                    return false;
+                if (captured_piece != pieces::NONE)
+                    remove_captured_piece(captured_piece, C::them, dest);
+                move_piece(moving_piece, Us, source, dest);
+
+                // Swap the pawn on dest for the new piece.
+                const Piece    promotion_piece = move.get_promotion_piece();
+                const Bitboard dest_bitboard   = util::one << dest;
+                pawns[Us]                  ^= dest_bitboard;
+                piece_bbs[promotion_piece] ^= dest_bitboard;
+                squares[dest]               = promotion_piece;
+
+                material -= evals::PIECE_CAPTURE_VALUES[promotion_piece]; // "-=", as we're adding it
+                material += evals::PAWN_CAPTURE_VALUES[Us]; // we "lost" the pawn.
+                remove_piece_square_score(moving_piece, dest);
+                add_piece_square_score(promotion_piece, dest);
+                pawn_key ^= zobrist::pawn_square[moving_piece][dest];
+                material_key += material_keys::UNITS[promotion_piece] - material_keys::UNITS[moving_piece];
+                hash_key ^= zobrist::piece_square[moving_piece][dest] ^ zobrist::piece_square[promotion_piece][dest];
+
+                ep_target_square = squares::NO_SQUARE;
+                fifty_move_count = 0;
             }
+            break;
 
-            Bitboard rook_mask;
-            switch (castling)
-            {
-            case moves::CASTLING_WHITE_KINGSIDE:
-                if (square_attacked(squares::f1, sides::white))
-                    return false;
+        case moves::MOVE_EN_PASSANT:
 
-                // Update the rook positions manually:
-                squares[squares::h1] = pieces::NONE;
-                squares[squares::f1] = pieces::WHITE_ROOK;
-                rook_mask = squarebits::h1 | squarebits::f1;
-                break;
+            // The captured pawn is the one that just went past dest: below it for white, above for black.
+            remove_captured_piece(SideConstants<C::them>::pawn, C::them, dest - C::forward);
+            move_piece(moving_piece, Us, source, dest);
+            ep_target_square = squares::NO_SQUARE;
+            fifty_move_count = 0;
+            break;
 
-            case moves::CASTLING_WHITE_QUEENSIDE:
-                if (square_attacked(squares::d1, sides::white))
-                    return false;
-                squares[squares::a1] = pieces::NONE;
-                squares[squares::d1] = pieces::WHITE_ROOK;
-                rook_mask = squarebits::a1 | squarebits::d1;
-                break;
+        case moves::MOVE_CASTLING:
+            {
+                const bool kingside = move.get_castling() == C::kingside_castling;
+                assert(!captured_piece);
 
-            case moves::CASTLING_BLACK_KINGSIDE:
-                if (square_attacked(squares::f8, sides::black))
+                // Canna castle out of, or through, check. The board hasn't changed yet, so the attacks are those before the move.
+                if (attacks_by(C::them) & (kingside ? C::kingside_king_path : C::queenside_king_path))
                     return false;
-                squares[squares::h8] = pieces::NONE;
-                squares[squares::f8] = pieces::BLACK_ROOK;
-                rook_mask = squarebits::h8 | squarebits::f8;
-                break;
-
-            case moves::CASTLING_BLACK_QUEENSIDE:
-                if (square_attacked(squares::d8, sides::black))
-                        return false;
-                squares[squares::a8] = pieces::NONE;
-                squares[squares::d8] = pieces::BLACK_ROOK;
-                rook_mask = squarebits::a8 | squarebits::d8;
-                break;
-
-            default:
-                break;
-            }
 
-            switch (castling)
-            {
-            case moves::CASTLING_NONE:
-                break;
-            default:
-                rooks[side] ^= rook_mask;
-                sides[side] ^= rook_mask;
-                whole_board ^= rook_mask;
+                move_piece(C::rook, Us, kingside ? C::kingside_rook_from : C::queenside_rook_from,
+                                        kingside ? C::kingside_rook_to   : C::queenside_rook_to);
+                move_piece(moving_piece, Us, source, dest);
+                ep_target_square = squares::NO_SQUARE;
+                ++fifty_move_count;
             }
-   
-            // Always do this:
-            move_common_first_stage(moving_piece, side, source, dest, source_and_dest_bitboard);
-            move_common_second_stage(captured_piece, side, dest_bitboard, source_bitboard, source_and_dest_bitboard);
-            castling_rights &= ~sides::CASTLING_RIGHTS_ANY[side];
-
             break;
+        }
 
-        case pieces::WHITE_ROOK:
-        case pieces::BLACK_ROOK:
-
-            move_common_first_stage(moving_piece, side, source, dest, source_and_dest_bitboard);
-            move_common_second_stage(captured_piece, side, dest_bitboard, source_bitboard, source_and_dest_bitboard);
+        castling_rights &= sides::CASTLING_RIGHTS_KEPT[source] & sides::CASTLING_RIGHTS_KEPT[dest];
 
-            // See notes in move_common_second_stage(), capture branch, and make_castling_mask(), for this logic to avoid branching 
-            // when removing castling rights.
-            // The difference is that source_bitboard is used here, rather than dest_bitboard in move_common_second_stage(); 
-            // note that it's ok to do all four cases, as if e.g. we're moving from h8 as a white rook, black doesn't have castling 
-            // rights there anyway; turning them off again is OK.
-            castling_rights &= ~make_castling_mask(source_bitboard); // If the bits in the mask are set, this turns off the relevant bits.
+        hash_key ^= zobrist::castling[old_castling_rights] ^ zobrist::castling[castling_rights];
+        hash_key ^= zobrist::en_passant[old_ep_target]    ^ zobrist::en_passant[ep_target_square];
 
-            break;
+        state.valid = 0;
 
-        case pieces::WHITE_KNIGHT:
-        case pieces::BLACK_KNIGHT:
-        case pieces::WHITE_BISHOP:
-        case pieces::BLACK_BISHOP:
-        case pieces::WHITE_QUEEN:
-        case pieces::BLACK_QUEEN:
+#ifdef OINK_INCREMENTAL_ATTACKS
+        Bitboard changed = (util::one << source) | (util::one << dest) | CASTLING_ROOK_SQUARES[move.get_castling()];
+        if (move.get_type() == moves::MOVE_EN_PASSANT)
+            changed |= squarebits::indexed[dest - C::forward];
+        update_attack_tables(changed);
+#endif
 
-            move_common_first_stage(moving_piece, side, source, dest, source_and_dest_bitboard);
-            move_common_second_stage(captured_piece, side, dest_bitboard, source_bitboard, source_and_dest_bitboard);
-            break;
-        }
+        // After the attack tables are brought up to date, as they're checked too.
+#ifdef OINK_CHECK_INCREMENTAL_EVAL
+        assert(incremental_evals_consistent());
+#endif
 
-        // If we're in check, it wasn't legal
-        return !detect_check(side);
+        // If we're in check, it wasn't legal. Nothing asks about the mover's king again, so there's no point caching the checkers,
+        // and square_attacked() can stop at the first attacker it finds.
+        return !square_attacked(get_first_occ_square(kings[Us]), Us);
     }
-}
\ No newline at end of file
+
+    template bool Position::make_move<sides::white>(Move move);
+    template bool Position::make_move<sides::black>(Move move);
+}
@@ -9,13 +9,57 @@
 #include <cassert>
 #include <cstring>
 
+// With OINK_INCREMENTAL_ATTACKS defined (the CMake option of the same name), the attacks of every piece, and the attackers of
+// every square, are kept up to date move by move rather than worked out when they're asked for. See engine/CMakeLists.txt.
+
 namespace chess
 {
+    // Check and pin information, shared by move generation, legality tests and check detection. Kept for both sides, as a
+    // Position doesn't know whose move it is.
+    struct StateInfo
+    {
+        Bitboard checkers[2];           // [king side] Pieces giving check to that side's king
+        Bitboard blockers[2];           // [king side] Pieces of either side which are all that stands between that king and an enemy slider
+        Bitboard rank_file_checks[2];   // [side] Squares from which that side's rooks and queens would give check
+        Bitboard diagonal_checks[2];    // [side] Squares from which that side's bishops and queens would give check
+        Bitboard attacks_by_piece[13];  // [piece] Squares attacked by all the pieces of that kind
+        Bitboard attacks_by_side[2];
+    };
+
+    // Which parts of a Position's StateInfo have been worked out since the last change to the board.
+    namespace state_parts
+    {
+        const unsigned char CHECKERS[2]   = { 0x1, 0x2 }; // [king side]
+        const unsigned char PINS          = 0x4;          // Pinned pieces and discovered check candidates
+        const unsigned char CHECK_SQUARES = 0x8;
+        const unsigned char ATTACKS[2]    = { 0x10, 0x20 }; // [side]
+    }
+
+    // A StateInfo and which of its parts are valid. Copying a Position copies none of it, as copy-make would mostly be copying
+    // what the move is about to throw away, and the bigger copy costs more than working the state out again.
+    struct StateCache
+    {
+        StateInfo     info;
+        unsigned char valid;
+
+        StateCache() : valid(0) {}
+        StateCache(const StateCache &) : valid(0) {}
+        StateCache &operator=(const StateCache &) { valid = 0; return *this; }
+    };
+
     class Position
     {
 		Bitboard generate_side(Side side) const;
-        void move_common_first_stage(Piece moving_piece, Side side, Square source, Square dest, Bitboard source_and_dest_bitboard);
-        void move_common_second_stage(Piece captured_piece, Side side_capturing, Bitboard dest_bitboard, Bitboard source_bitboard, Bitboard source_and_dest_bitboard);
+        // The pieces of make_move: the moving piece goes to an empty square, so any capture is taken off first.
+        void move_piece(Piece piece, Side side, Square source, Square dest);
+        void remove_captured_piece(Piece piece, Side side, Square where);
+        void compute_checkers(Side king_side) const;
+        void compute_pins() const;
+        void compute_check_squares() const;
+        void compute_attacks(Side side) const;
+#ifdef OINK_INCREMENTAL_ATTACKS
+        void update_attack_tables(Bitboard changed);
+#endif
 	public:
         union
         {
@@ -38,16 +82,130 @@ namespace chess
         unsigned char fifty_move_count;
         unsigned char castling_rights; // bitmask
         PosEvaluation material;
+        // Sum of the piece-square tables over all pieces, kept up to date by make_move() just like material.
+        Score         psq;
+        // Zobrist key of the pawns alone (see zobrist::pawn_square), for the pawn hash table.
+        HashKey       pawn_key;
+        // Piece counts (see material_keys), for looking up endgames.
+        HashKey       material_key;
+        // Zobrist key of the pieces, castling rights and EP square. Doesn't include the side to move (see zobrist::black_to_move).
+        HashKey       hash_key;
+#ifdef OINK_INCREMENTAL_ATTACKS
+        // Kept up to date by make_move(), which only revisits the pieces on the squares it changes and the sliders whose lines
+        // run through them.
+        Bitboard      attacks_from[util::NUM_SQUARES]; // [square] Squares attacked by the piece there, if any
+        Bitboard      attacks_to[util::NUM_SQUARES];   // [square] Pieces of either side attacking it
+#endif
 
         Position();
 
         void clear();
         void setup_starting_position();
         void update_sides();
+        // Full recalculation of the incrementally-updated terms (material, evaluation and hash keys), for when the bitboards have been set up directly.
+        void recompute_incremental_evals();
+        void compute_incremental_evals(Score &psq_out) const;
+        PosEvaluation compute_material() const;
+        HashKey compute_pawn_key() const;
+        HashKey compute_material_key() const;
+        HashKey compute_hash_key() const;
+#ifdef OINK_INCREMENTAL_ATTACKS
+        void compute_attack_tables();
+        bool attack_tables_consistent() const;
+#endif
         // Returns whether the move was successfully made.
-		bool make_move(Move move);
+		OINK_INLINE bool make_move(Move move)
+        {
+            return get_piece_side(move.get_piece()) == sides::white ? make_move<sides::white>(move) : make_move<sides::black>(move);
+        }
+        // As above, for a move by a side known at compile time. Instantiated for both sides.
+        template<Side Us> bool make_move(Move move);
         bool detect_check(Side king_side) const;
         bool square_attacked(Square square, Side side) const;
+        // As above, but with sliders seeing through the given occupancy rather than whole_board
+        // (e.g. with the king lifted off, to test the squares it could step to).
+        bool square_attacked(Square square, Side side, Bitboard occupancy) const;
+        // Pieces of both sides attacking the square, with sliders seeing through the given occupancy. Pieces not in the
+        // occupancy may still be included, so mask them off if they've been taken away.
+        Bitboard attackers_to(Square square, Bitboard occupancy) const;
+
+        // Check and pin information, cached until the board changes or the Position is copied (see StateCache).
+        OINK_INLINE Bitboard checkers(Side king_side) const
+        {
+            if (!(state.valid & state_parts::CHECKERS[king_side]))
+                compute_checkers(king_side);
+            return state.info.checkers[king_side];
+        }
+
+        // The side's pieces pinned to its own king.
+        OINK_INLINE Bitboard pinned(Side side) const
+        {
+            if (!(state.valid & state_parts::PINS))
+                compute_pins();
+            return state.info.blockers[side] & sides[side];
+        }
+
+        // The side's pieces which would give check by moving off the line from one of its sliders to the enemy king.
+        OINK_INLINE Bitboard discovered_check_candidates(Side side) const
+        {
+            if (!(state.valid & state_parts::PINS))
+                compute_pins();
+            return state.info.blockers[swap_side(side)] & sides[side];
+        }
+
+        // Every square the side attacks, whether or not it could legally move there.
+        OINK_INLINE Bitboard attacks_by(Side side) const
+        {
+            if (!(state.valid & state_parts::ATTACKS[side]))
+                compute_attacks(side);
+            return state.info.attacks_by_side[side];
+        }
+
+        // Every square attacked by the pieces of that kind, e.g. pieces::BLACK_KNIGHT.
+        OINK_INLINE Bitboard attacks_by_piece(Piece piece) const
+        {
+            Side side = get_piece_side(piece);
+            if (!(state.valid & state_parts::ATTACKS[side]))
+                compute_attacks(side);
+            return state.info.attacks_by_piece[piece];
+        }
+
+        // Squares from which the piece would give check to the enemy king.
+        OINK_INLINE Bitboard check_squares(Piece piece) const
+        {
+            Side   side        = get_piece_side(piece);
+            Square king_square = get_first_occ_square(kings[swap_side(side)]);
+
+            // The pawn, knight and king tables are cheap enough not to bother caching.
+            switch (piece)
+            {
+            case pieces::WHITE_PAWN:
+            case pieces::BLACK_PAWN:
+                // A pawn of ours attacks the king from wherever one of its pawns on the king's square would attack.
+                return moves::pawn_captures[swap_side(side)][king_square];
+            case pieces::WHITE_KNIGHT:
+            case pieces::BLACK_KNIGHT:
+                return moves::knight_moves[king_square];
+            case pieces::WHITE_KING:
+            case pieces::BLACK_KING:
+                return util::nil;
+            }
+
+            if (!(state.valid & state_parts::CHECK_SQUARES))
+                compute_check_squares();
+
+            switch (piece)
+            {
+            case pieces::WHITE_ROOK:
+            case pieces::BLACK_ROOK:
+                return state.info.rank_file_checks[side];
+            case pieces::WHITE_BISHOP:
+            case pieces::BLACK_BISHOP:
+                return state.info.diagonal_checks[side];
+            default:
+                return state.info.rank_file_checks[side] | state.info.diagonal_checks[side];
+            }
+        }
 
         OINK_INLINE Bitboard get_empty_squares() const
         {
@@ -60,6 +218,29 @@ namespace chess
             assert(util::nil == (sides[sides::white] & sides[sides::black]));
         }
 
+        // Checks the incrementally-updated terms against a full recalculation.
+        bool incremental_evals_consistent() const
+        {
+            Score         full_psq;
+            compute_incremental_evals(full_psq);
+            return full_psq == psq && compute_material() == material &&
+                   compute_pawn_key() == pawn_key && compute_material_key() == material_key && compute_hash_key() == hash_key
+#ifdef OINK_INCREMENTAL_ATTACKS
+                   && attack_tables_consistent()
+#endif
+                   ;
+        }
+
+        OINK_INLINE void add_piece_square_score(Piece piece, Square square)
+        {
+            psq += evals::piece_square[piece][square];
+        }
+
+        OINK_INLINE void remove_piece_square_score(Piece piece, Square square)
+        {
+            psq -= evals::piece_square[piece][square];
+        }
+
         bool operator==(const Position& other) const
         {
             return memcmp(piece_bbs, other.piece_bbs, sizeof(piece_bbs)) == 0 &&
@@ -68,22 +249,41 @@ namespace chess
                    ep_target_square == other.ep_target_square &&
                    fifty_move_count == other.fifty_move_count &&
                    castling_rights  == other.castling_rights &&
-                   material         == other.material;
+                   material         == other.material &&
+                   psq              == other.psq &&
+                   pawn_key         == other.pawn_key &&
+                   material_key     == other.material_key &&
+                   hash_key         == other.hash_key;
         }
 
         void manually_move_piece(Piece piece, Square from, Square to)
         {
+            state.valid = 0;
             piece_bbs[piece] |= squarebits::indexed[to];
             piece_bbs[piece] &= ~squarebits::indexed[from];
             squares[from] = pieces::NONE;
             squares[to]   = piece;
+            remove_piece_square_score(piece, from);
+            add_piece_square_score(piece, to);
+            pawn_key ^= zobrist::pawn_square[piece][from] ^ zobrist::pawn_square[piece][to];
+            hash_key ^= zobrist::piece_square[piece][from] ^ zobrist::piece_square[piece][to];
         }
 
         void place_piece(Piece piece, Square where)
         {
+            state.valid = 0;
             piece_bbs[piece] |= squarebits::indexed[where];
             squares[where]   = piece;
+            material        -= evals::PIECE_CAPTURE_VALUES[piece];
+            add_piece_square_score(piece, where);
+            pawn_key ^= zobrist::pawn_square[piece][where];
+            material_key += material_keys::UNITS[piece];
+            hash_key ^= zobrist::piece_square[piece][where];
         }
+
+    private:
+        // Filled in lazily, a part at a time, by the accessors above. Anything that changes the board invalidates it.
+        mutable StateCache state;
     };
 }
 
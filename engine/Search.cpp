@@ -3,6 +3,10 @@
 #include "MoveGenerator.hpp"
 #include "BasicOperations.hpp"
 #include "Evaluator.hpp"
+#include "PawnHash.hpp"
+#include "EvalCache.hpp"
+#include "Nnue.hpp"
+#include "See.hpp"
 
 //#define OINK_SEARCH_DIAGNOSTICS
 
@@ -16,27 +20,280 @@ using namespace chess::util;
 
 namespace chess
 {
-    MoveAndEval minimax(Side side_moving, const Position &pos, int depth)
+    static uint64_t nodes_searched;
+    static uint64_t quiescence_nodes;
+    static uint64_t leaf_evals;
+    static EvalType eval_type = EVAL_CLASSICAL;
+
+    void reset_search_statistics()
+    {
+        nodes_searched   = 0;
+        quiescence_nodes = 0;
+        leaf_evals       = 0;
+
+        reset_eval_stage_counts();
+
+        PawnHashTable &pawn_hash_table = get_pawn_hash_table();
+        pawn_hash_table.probes = 0;
+        pawn_hash_table.hits   = 0;
+
+        EvalCache &eval_cache = get_eval_cache();
+        eval_cache.probes.store(0, std::memory_order_relaxed);
+        eval_cache.hits.store(0, std::memory_order_relaxed);
+    }
+
+    SearchStatistics get_search_statistics()
+    {
+        const PawnHashTable &pawn_hash_table = get_pawn_hash_table();
+        const EvalCache     &eval_cache      = get_eval_cache();
+
+        SearchStatistics stats;
+        stats.nodes             = nodes_searched;
+        stats.quiescence_nodes  = quiescence_nodes;
+        stats.leaf_evals        = leaf_evals;
+        stats.pawn_hash_probes  = pawn_hash_table.probes;
+        stats.pawn_hash_hits    = pawn_hash_table.hits;
+        stats.eval_cache_probes = eval_cache.probes.load(std::memory_order_relaxed);
+        stats.eval_cache_hits   = eval_cache.hits.load(std::memory_order_relaxed);
+        get_eval_stage_counts(stats.eval_stages);
+        return stats;
+    }
+
+    bool set_eval_type(EvalType type)
+    {
+        if (type == EVAL_NNUE && !nnue::network_loaded())
+            return false;
+
+        eval_type = type;
+        return true;
+    }
+
+    EvalType get_eval_type()
+    {
+        return eval_type;
+    }
+
+    // Only used under EVAL_NNUE. A null accumulator means no network evaluation is wanted.
+    static OINK_INLINE const nnue::Accumulator *root_accumulator(nnue::Accumulator &storage, const Position &pos)
+    {
+        if (eval_type != EVAL_NNUE)
+            return nullptr;
+
+        storage.refresh(pos);
+        return &storage;
+    }
+
+    // Only the classical evaluation makes use of the window, to stop early: see eval_position().
+    static OINK_INLINE PosEvaluation evaluate_leaf(Side side_to_move, const Position &pos, int alpha, int beta,
+                                                   const nnue::Accumulator *accumulator)
+    {
+        ++leaf_evals;
+
+        switch (eval_type)
+        {
+        case EVAL_MATERIAL:
+            return side_to_move == sides::white ? pos.material : -pos.material;
+        case EVAL_NNUE:
+            return nnue::evaluate(*accumulator, side_to_move);
+        default:
+            return eval_position(side_to_move, pos, alpha, beta);
+        }
+    }
+
+    // Captures, and promotions to a queen (the others are only ever worth trying in the full search).
+    static OINK_INLINE bool is_tactical(Move move)
+    {
+        Piece promotion = move.get_promotion_piece();
+        return promotion == pieces::NONE ? move.get_captured_piece() != pieces::NONE
+                                         : promotion == pieces::WHITE_QUEEN || promotion == pieces::BLACK_QUEEN;
+    }
+
+    // Most valuable victim first, then least valuable attacker.
+    static OINK_INLINE int mvv_lva_key(Move move)
+    {
+        Piece promotion = move.get_promotion_piece();
+        return 16 * (see_value(move.get_captured_piece()) + (promotion != pieces::NONE ? see_value(promotion) : 0)) -
+               ((move.get_piece() - 1) >> 1);
+    }
+
+    // Sorts the moves by descending key, keeping the generated order among equals.
+    static void sort_moves(MoveVector &moves, int keys[])
+    {
+        for (uint32_t i = 1; i < moves.size; ++i)
+        {
+            Move move = moves.moves[i];
+            int  key  = keys[i];
+            uint32_t j = i;
+            for (; j > 0 && keys[j - 1] < key; --j)
+            {
+                moves.moves[j] = moves.moves[j - 1];
+                keys[j]        = keys[j - 1];
+            }
+            moves.moves[j] = move;
+            keys[j]        = key;
+        }
+    }
+
+    // Captures and promotions that don't lose material, best first, then the quiet moves, checks first, then the losing captures.
+    static void order_moves(MoveVector &moves, const Position &pos)
+    {
+        const int WINNING = 1 << 24, LOSING = -(1 << 24);
+
+        int keys[256];
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            Move move = moves[i];
+            if (!is_tactical(move))
+                keys[i] = gives_check(pos, move) ? 1 : 0;
+            else
+                keys[i] = mvv_lva_key(move) + (see_ge(pos, move, 0) ? WINNING : LOSING);
+        }
+
+        sort_moves(moves, keys);
+    }
+
+    // The moves searched by quiescence: tactical moves that don't lose material, in MVV/LVA order, then, if wanted, the quiet
+    // checks that don't lose material either. In check, it's every evasion instead.
+    template<Side Us>
+    static void generate_quiescence_moves(MoveVector &moves, const Position &pos, bool in_check, bool with_checks)
+    {
+        if (in_check)
+        {
+            generate_evasions<Us>(moves, pos);
+            order_moves(moves, pos);
+            return;
+        }
+
+        MoveVector all_moves;
+        generate_all_moves<Us>(all_moves, pos);
+
+        int keys[256];
+        for (uint32_t i = 0; i < all_moves.size; ++i)
+        {
+            Move move = all_moves[i];
+            if (is_tactical(move) && see_ge(pos, move, 0))
+            {
+                keys[moves.size] = mvv_lva_key(move);
+                moves.push_back(move);
+            }
+        }
+
+        sort_moves(moves, keys);
+
+        if (with_checks)
+        {
+            MoveVector checks;
+            generate_quiet_checks(checks, pos, Us);
+            for (uint32_t i = 0; i < checks.size; ++i)
+            {
+                if (see_ge(pos, checks[i], 0))
+                    moves.push_back(checks[i]);
+            }
+        }
+    }
+
+    // Searches captures only (and queen promotions), so that leaves aren't evaluated in the middle of an exchange. On its
+    // first ply (depth 0) it tries quiet checks as well.
+    // The side to move can always "stand pat" on the static evaluation instead, so there's no stalemate detection. The
+    // exception is being in check on the first two plies, i.e. from the last move of the main search or from one of the
+    // quiet checks: then it has to get out of it, and is mated if it can't. Any deeper and the evasions, which can give
+    // check themselves, would make the search explode. Depth counts down from 0, as in the main search.
+    // Like the main search, it's templated on the side to move, alternating between the two instantiations ply by ply.
+    template<Side Us>
+    static PosEvaluation quiesce(const Position &pos, int alpha, int beta, const nnue::Accumulator *accumulator, int depth)
+    {
+        bool in_check = depth >= -1 && pos.checkers(Us) != nil;
+        if (!in_check)
+        {
+            PosEvaluation stand_pat = evaluate_leaf(Us, pos, alpha, beta, accumulator);
+            if (stand_pat >= beta)
+                return beta;
+            if (stand_pat > alpha)
+                alpha = stand_pat;
+        }
+
+        MoveVector moves;
+        generate_quiescence_moves<Us>(moves, pos, in_check, depth == 0);
+        bool any_legal = false;
+        for (uint32_t i = 0, num_moves = moves.size; i < num_moves; ++i)
+        {
+            Position test = pos;
+
+            if (test.make_move<Us>(moves[i]))
+            {
+                ++nodes_searched;
+                ++quiescence_nodes;
+                any_legal = true;
+
+                nnue::Accumulator child_accumulator;
+                if (accumulator)
+                    child_accumulator.update(*accumulator, moves[i]);
+                const nnue::Accumulator *child = accumulator ? &child_accumulator : nullptr;
+
+                PosEvaluation eval = -quiesce<SideConstants<Us>::them>(test, -beta, -alpha, child, depth - 1);
+                if (eval >= beta)
+                    return beta;
+                if (eval > alpha)
+                    alpha = eval;
+            }
+        }
+
+        if (in_check && !any_legal)
+        {
+            PosEvaluation mated = -(evals::MATE_SCORE + depth);
+            return std::max(alpha, std::min(mated, beta));
+        }
+        return alpha;
+    }
+
+    // Checks on the last ply are searched a ply deeper, rather than left to quiescence, so long as they don't lose material.
+    // Not when the check is itself a way out of check, or a run of cross-checks could go on for ever.
+    static OINK_INLINE int child_depth(Side side_moving, const Position &pos, Move move, int depth)
+    {
+        if (depth == 1 && !pos.checkers(side_moving) && gives_check(pos, move) && see_ge(pos, move, 0))
+            return depth;
+        return depth - 1;
+    }
+
+    // The side to move has no legal moves: it's mate if they're in check, otherwise stalemate.
+    // Mates nearer the root (more depth remaining) score more highly, so that the shortest mate is preferred.
+    static PosEvaluation no_legal_moves_eval(Side side_moving, const Position &pos, int depth)
+    {
+        return pos.detect_check(side_moving) ? -(evals::MATE_SCORE + depth) : evals::DRAW_SCORE;
+    }
+
+    // The search proper is templated on the side to move, so that generation and make_move needn't branch on it. The public
+    // entry points below pick the instantiation once, at the root.
+    template<Side Us>
+    static MoveAndEval minimax(const Position &pos, int depth, const nnue::Accumulator *accumulator)
     {
         MoveAndEval result;
         // If this doesn't get bettered, then we have no legal moves.
         result.best_eval = evals::INITIAL_SEARCH_VALUE;
 
         MoveVector moves;
-        generate_all_moves(moves, pos, side_moving);
+        generate_moves<Us>(moves, pos);
         //std::sort(moves.begin(), moves.end(), [](Move a, Move b) { return a.get_captured_piece() > b.get_captured_piece(); });
         for (uint32_t i = 0, num_moves = moves.size; i < num_moves; ++i)
         {
             Position test = pos;
 
-            if (test.make_move(moves[i]))
+            if (test.make_move<Us>(moves[i]))
             {
+                ++nodes_searched;
+
+                nnue::Accumulator child_accumulator;
+                if (accumulator)
+                    child_accumulator.update(*accumulator, moves[i]);
+                const nnue::Accumulator *child = accumulator ? &child_accumulator : nullptr;
+
                 PosEvaluation leaf_eval;
-                // Do the leaf eval here, rather than make the extra recursive call.
-                if (depth == 1)
-                    leaf_eval = -eval_position(swap_side(side_moving), test, depth);
+                int next_depth = child_depth(Us, pos, moves[i], depth);
+                // There's no minimax version of quiescence: it'd take forever without cutoffs. With a full window it's still exact.
+                if (next_depth == 0)
+                    leaf_eval = -quiesce<SideConstants<Us>::them>(test, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE, child, 0);
                 else
-                    leaf_eval = -minimax(swap_side(side_moving), test, depth - 1).best_eval;
+                    leaf_eval = -minimax<SideConstants<Us>::them>(test, next_depth, child).best_eval;
 
                 if (leaf_eval > result.best_eval)
                 {
@@ -48,18 +305,14 @@ namespace chess
 
         // There were no legal moves. 
         // This means we're either in mate, or stalemate (but we're not at the desired search depth)
-        // So we need to do static evaluation for this node.
         if (result.best_eval == evals::INITIAL_SEARCH_VALUE)
-        {
-            result.best_eval = eval_position(side_moving, pos, depth);
-            if (result.best_eval != evals::DRAW_SCORE && result.best_eval > -evals::MATE_SCORE)
-                 printf("\n****** ERROR: unexpected eval : %d\n", result.best_eval);
-        }
+            result.best_eval = no_legal_moves_eval(Us, pos, depth);
 
         return result;
     }
 
-    MoveAndEval alpha_beta(Side side_moving, const Position &pos, int depth, int alpha, int beta)
+    template<Side Us>
+    static MoveAndEval alpha_beta(const Position &pos, int depth, int alpha, int beta, const nnue::Accumulator *accumulator)
     {
         MoveAndEval result;
         // best_eval takes place of alpha. Since best_eval doesn't start at -infinity (cf. minimax),
@@ -68,21 +321,29 @@ namespace chess
         bool any_legal = false;
 
         MoveVector moves;
-        generate_all_moves(moves, pos, side_moving);
-        //std::sort(moves.begin(), moves.end(), [](Move a, Move b) { return a.get_captured_piece() > b.get_captured_piece(); });
+        generate_moves<Us>(moves, pos);
+        order_moves(moves, pos);
         for (uint32_t i = 0, num_moves = moves.size; i < num_moves; ++i)
         {
             Position test = pos;
 
-            if (test.make_move(moves[i]))
+            if (test.make_move<Us>(moves[i]))
             {
+                ++nodes_searched;
+
+                nnue::Accumulator child_accumulator;
+                if (accumulator)
+                    child_accumulator.update(*accumulator, moves[i]);
+                const nnue::Accumulator *child = accumulator ? &child_accumulator : nullptr;
+
                 PosEvaluation leaf_eval;
-                if (depth == 1)
+                int next_depth = child_depth(Us, pos, moves[i], depth);
+                if (next_depth == 0)
                 {
-                    leaf_eval = -eval_position(swap_side(side_moving), test, depth);
+                    leaf_eval = -quiesce<SideConstants<Us>::them>(test, -beta, -result.best_eval, child, 0);
 #ifdef OINK_SEARCH_DIAGNOSTICS
                     printf("LEAF:\n");
-                    print_move(moves[i], -1, side_moving, util::NORMAL, leaf_eval);
+                    print_move(moves[i], -1, Us, util::NORMAL, leaf_eval);
                     print_position(test);
 #endif
                 }
@@ -90,10 +351,10 @@ namespace chess
                 {
 #ifdef OINK_SEARCH_DIAGNOSTICS
                     printf("NON-LEAF:\n");
-                    print_move(moves[i], -1, side_moving, util::NORMAL, 0);
+                    print_move(moves[i], -1, Us, util::NORMAL, 0);
                     print_position(test);
 #endif
-                    leaf_eval = -alpha_beta(swap_side(side_moving), test, depth - 1, -beta, -result.best_eval).best_eval;
+                    leaf_eval = -alpha_beta<SideConstants<Us>::them>(test, next_depth, -beta, -result.best_eval, child).best_eval;
                 }
 
                 if (leaf_eval >= beta)
@@ -115,14 +376,24 @@ namespace chess
 
         // There were no legal moves. 
         // This means we're either in mate, or stalemate (but we're not at the desired search depth)
-        // So we need to do static evaluation for this node.
         if (!any_legal)
-        {
-            result.best_eval = eval_position(side_moving, pos, depth);
-            if (result.best_eval != evals::DRAW_SCORE && result.best_eval > -evals::MATE_SCORE)
-                 printf("\n****** ERROR: unexpected eval : %d\n", result.best_eval);
-        }
+            result.best_eval = no_legal_moves_eval(Us, pos, depth);
 
         return result;
     }
-}
\ No newline at end of file
+
+    MoveAndEval minimax(Side side_moving, const Position &pos, int depth)
+    {
+        nnue::Accumulator accumulator;
+        const nnue::Accumulator *root = root_accumulator(accumulator, pos);
+        return side_moving == sides::white ? minimax<sides::white>(pos, depth, root) : minimax<sides::black>(pos, depth, root);
+    }
+
+    MoveAndEval alpha_beta(Side side_moving, const Position &pos, int depth, int alpha, int beta)
+    {
+        nnue::Accumulator accumulator;
+        const nnue::Accumulator *root = root_accumulator(accumulator, pos);
+        return side_moving == sides::white ? alpha_beta<sides::white>(pos, depth, alpha, beta, root)
+                                           : alpha_beta<sides::black>(pos, depth, alpha, beta, root);
+    }
+}
@@ -4,6 +4,7 @@
 #include "BasicTypes.hpp"
 #include "ChessConstants.hpp"
 #include "Move.hpp"
+#include "Evaluator.hpp"
 
 namespace chess
 {
@@ -15,6 +16,36 @@ namespace chess
         Move          best_move;
     };
 
+    // Counts accumulated over every search since the last reset_search_statistics().
+    struct SearchStatistics
+    {
+        uint64_t nodes;            // Positions reached by a legal move, including leaves and quiescence
+        uint64_t quiescence_nodes;
+        uint64_t leaf_evals;
+        uint64_t pawn_hash_probes;
+        uint64_t pawn_hash_hits;
+        uint64_t eval_cache_probes;
+        uint64_t eval_cache_hits;
+        uint64_t eval_stages[NUM_EVAL_STAGES];  // Classical evaluations by where they finished, see EvalStage
+    };
+
+    void reset_search_statistics();
+    SearchStatistics get_search_statistics();
+
+    // What the search calls at its leaves.
+    enum EvalType
+    {
+        EVAL_CLASSICAL,  // eval_position()
+        EVAL_MATERIAL,   // Material only, as a baseline for measuring the others
+        EVAL_NNUE        // nnue::evaluate(), which needs a network loaded first
+    };
+
+    // Refuses EVAL_NNUE, returning false and keeping the current evaluation, until a network has been loaded: without one,
+    // every position would score 0.
+    bool     set_eval_type(EvalType type);
+    EvalType get_eval_type();
+
+    // Both searches go on past the given depth with a quiescence search of the captures that don't lose material (by SEE).
     MoveAndEval minimax(Side side_moving, const Position &pos, int depth);
     MoveAndEval alpha_beta(Side side_moving, const Position &pos, int depth, int alpha, int beta);
 }
@@ -0,0 +1,142 @@
+#include "See.hpp"
+#include "Position.hpp"
+#include "BasicOperations.hpp"
+
+#include <algorithm>
+
+namespace chess
+{
+    // The first side to run out of attackers loses the exchange, so this can't be longer than all the pieces on the board.
+    static const int MAX_EXCHANGE_LENGTH = 32;
+
+    // What a pawn gains by promoting (always to a queen, in an exchange).
+    static OINK_INLINE PosEvaluation promotion_gain()
+    {
+        return see_value(pieces::WHITE_QUEEN) - see_value(pieces::WHITE_PAWN);
+    }
+
+    // Only one side's pawns can reach any given back rank square, so there's no need to say whose.
+    static OINK_INLINE bool is_promotion_square(Square square)
+    {
+        RankFile rank = square_to_rank(square);
+        return rank == ranks::first || rank == ranks::eighth;
+    }
+
+    // The side's least valuable piece among the attackers, and where it is.
+    static OINK_INLINE Piece least_valuable_attacker(const Position &pos, Bitboard attackers, Side side, Bitboard &attacker_bitboard)
+    {
+        const Piece by_value[] = { pieces::PAWNS[side], pieces::KNIGHTS[side], pieces::BISHOPS[side],
+                                   pieces::ROOKS[side], pieces::QUEENS[side],  pieces::KINGS[side] };
+
+        for (Piece piece : by_value)
+        {
+            Bitboard b = attackers & pos.piece_bbs[piece];
+            if (b)
+            {
+                attacker_bitboard = b & (util::nil - b);
+                return piece;
+            }
+        }
+
+        attacker_bitboard = util::nil;
+        return pieces::NONE;
+    }
+
+    PosEvaluation see(const Position &pos, Move move)
+    {
+        const Square dest      = move.get_destination();
+        const Piece  piece     = move.get_piece();
+        const Piece  promotion = move.get_promotion_piece();
+        Side side = get_piece_side(piece);
+
+        Bitboard occupancy = pos.whole_board ^ (util::one << move.get_source());
+        if (move.get_en_passant() != pieces::NONE)
+            occupancy ^= util::one << (dest - sides::NEXT_RANK_OFFSET[side]);
+
+        // gains[i]: the material balance after the i'th capture, from the point of view of the side that made it,
+        // if the exchange were to stop there.
+        PosEvaluation gains[MAX_EXCHANGE_LENGTH];
+        gains[0] = see_value(move.get_captured_piece());
+
+        Piece on_square = piece;
+        if (promotion != pieces::NONE)
+        {
+            gains[0] += see_value(promotion) - see_value(piece);
+            on_square = promotion;
+        }
+
+        const Bitboard diagonal_sliders  = pos.bishops[sides::white] | pos.bishops[sides::black] | pos.queens[sides::white] | pos.queens[sides::black];
+        const Bitboard rank_file_sliders  = pos.rooks[sides::white]   | pos.rooks[sides::black]   | pos.queens[sides::white] | pos.queens[sides::black];
+        Bitboard attackers = pos.attackers_to(dest, occupancy) & occupancy;
+
+        // Removing an attacker can only uncover a slider on the same line through the destination.
+        const Bitboard diagonal_lines  = diagonal_attacks(dest, util::nil);
+        const Bitboard rank_file_lines = rank_file_attacks(dest, util::nil);
+
+        int depth = 0;
+        while (depth < MAX_EXCHANGE_LENGTH - 1)
+        {
+            side = swap_side(side);
+
+            Bitboard attacker_bitboard;
+            Piece attacker = least_valuable_attacker(pos, attackers, side, attacker_bitboard);
+            if (attacker == pieces::NONE)
+                break;
+
+            // The king can only take if there's nothing to take it back.
+            if (attacker == pieces::KINGS[side] && (attackers & pos.sides[swap_side(side)]))
+                break;
+
+            ++depth;
+            gains[depth] = see_value(on_square) - gains[depth - 1];
+            on_square = attacker;
+
+            if (attacker == pieces::PAWNS[side] && is_promotion_square(dest))
+            {
+                gains[depth] += promotion_gain();
+                on_square = pieces::QUEENS[side];
+            }
+
+            // Uncover anything lined up behind the piece that's just captured.
+            occupancy ^= attacker_bitboard;
+            if (attacker_bitboard & diagonal_lines)
+                attackers |= diagonal_attacks(dest, occupancy)  & diagonal_sliders;
+            else if (attacker_bitboard & rank_file_lines)
+                attackers |= rank_file_attacks(dest, occupancy) & rank_file_sliders;
+            attackers &= occupancy;
+        }
+
+        // Work back from the end: at each step, the side to capture can choose not to, if that's better for them.
+        while (depth > 0)
+        {
+            gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+            --depth;
+        }
+
+        return gains[0];
+    }
+
+    bool see_ge(const Position &pos, Move move, PosEvaluation threshold)
+    {
+        const Piece promotion = move.get_promotion_piece();
+
+        // The most the move can win is what it takes. If the opponent recaptures, it can't be worse than losing the piece
+        // moved, however the exchange goes on from there (if it's a recapture by a pawn, that might promote too).
+        PosEvaluation best_case = see_value(move.get_captured_piece());
+        PosEvaluation at_risk   = see_value(move.get_piece());
+        if (promotion != pieces::NONE)
+        {
+            best_case += see_value(promotion) - see_value(move.get_piece());
+            at_risk    = see_value(promotion);
+        }
+        if (is_promotion_square(move.get_destination()))
+            at_risk += promotion_gain();
+
+        if (best_case < threshold)
+            return false;
+        if (best_case - at_risk >= threshold)
+            return true;
+
+        return see(pos, move) >= threshold;
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef SEE_HPP
+#define SEE_HPP
+
+#include "BasicTypes.hpp"
+#include "Move.hpp"
+
+#include <cstdlib>
+
+namespace chess
+{
+    class Position;
+
+    // A piece's value to the exchange, whichever side it's on. Also what move ordering weighs captures by.
+    OINK_INLINE PosEvaluation see_value(Piece piece)
+    {
+        return std::abs(evals::PIECE_CAPTURE_VALUES[piece]);
+    }
+
+    // Static exchange evaluation: the material the move wins (or loses, if negative), assuming that both sides then take turns
+    // to capture on its destination square, each with their least valuable piece, for as long as it pays them to.
+    // Sliders lined up behind the pieces that capture join in as they're uncovered. Pins and checks are ignored,
+    // except that a king won't capture onto a defended square.
+    // Works for any move, though anything other than a capture or promotion can only break even or lose.
+    PosEvaluation see(const Position &pos, Move move);
+
+    // Whether see(pos, move) >= threshold, usually without having to play out the exchange.
+    bool see_ge(const Position &pos, Move move, PosEvaluation threshold);
+}
+
+#endif // SEE_HPP
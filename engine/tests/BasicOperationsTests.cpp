@@ -60,10 +60,78 @@ TEST_P(BitwiseOpsTests, get_first_occ_square_WorksWith_SingleSquareSetOnInitialB
 	ASSERT_EQ(GetParam().index, index);
 }
 
+TEST_P(BitwiseOpsTests, SetwiseKnightAndKingAttacks_MatchTables)
+{
+	Square index = GetParam().index;
+	ASSERT_EQ(moves::knight_moves[index], all_knight_attacks(GetParam().board));
+	ASSERT_EQ(moves::king_moves[index],   all_king_attacks(GetParam().board));
+}
+
 INSTANTIATE_TEST_CASE_P(SingleSquareInputs,
                         BitwiseOpsTests,
                         ::testing::ValuesIn(GenerateSquares()()));
 
+TEST_P(BitwiseOpsTests, Rays_CoverEmptyBoardSliderAttacks)
+{
+	Square   index = GetParam().index;
+	Bitboard all_rays = util::nil;
+	for (int direction = geometry::NORTH; direction < geometry::NUM_DIRECTIONS; ++direction)
+	{
+		Bitboard b = ray(index, geometry::Direction(direction));
+		ASSERT_EQ(util::nil, all_rays & b);
+		all_rays |= b;
+
+		// Anything further along the ray is cut off by whatever is on the square before it.
+		Square to;
+		while (b)
+		{
+			b = get_and_clear_first_occ_square(b, &to);
+			ASSERT_EQ(ray(index, geometry::Direction(direction)) & ~ray(to, geometry::Direction(direction)) & ~(util::one << to),
+			          between(index, to));
+			ASSERT_TRUE(aligned(index, to, index));
+		}
+	}
+	ASSERT_EQ(diagonal_attacks(index, util::nil) | rank_file_attacks(index, util::nil), all_rays);
+}
+
+class GeometryTests : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		constants_initialize();
+	}
+};
+
+TEST_F(GeometryTests, TestThat_Between_IsEmptyOffLines)
+{
+	ASSERT_EQ(squarebits::b2 | squarebits::c3, between(squares::a1, squares::d4));
+	ASSERT_EQ(between(squares::a1, squares::d4), between(squares::d4, squares::a1));
+	ASSERT_EQ(squarebits::e2, between(squares::e1, squares::e3));
+	ASSERT_EQ(util::nil, between(squares::e1, squares::e2));
+	ASSERT_EQ(util::nil, between(squares::a1, squares::b3));
+	ASSERT_EQ(util::nil, line_through(squares::a1, squares::b3));
+}
+
+TEST_F(GeometryTests, TestThat_Aligned_FollowsWholeLine)
+{
+	ASSERT_TRUE(aligned(squares::c3, squares::d4, squares::a1));
+	ASSERT_TRUE(aligned(squares::c3, squares::d4, squares::h8));
+	ASSERT_FALSE(aligned(squares::c3, squares::d4, squares::a8));
+	ASSERT_TRUE(aligned(squares::a4, squares::c4, squares::h4));
+	ASSERT_FALSE(aligned(squares::a4, squares::c4, squares::h5));
+	ASSERT_EQ(8, count_bits(line_through(squares::b1, squares::b7)));
+}
+
+TEST_F(GeometryTests, TestThat_Distance_CountsKingMoves)
+{
+	ASSERT_EQ(0, distance(squares::e4, squares::e4));
+	ASSERT_EQ(1, distance(squares::e4, squares::f5));
+	ASSERT_EQ(7, distance(squares::a1, squares::h8));
+	ASSERT_EQ(7, distance(squares::a1, squares::b8));
+	ASSERT_EQ(3, distance(squares::g1, squares::d2));
+}
+
 } //anonymous namespace
 
 int main(int argc, char **argv)
@@ -0,0 +1,106 @@
+#include <engine/Endgame.hpp>
+#include <engine/Evaluator.hpp>
+#include <engine/Position.hpp>
+#include <fen_parser/FenParser.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace chess;
+using namespace std;
+
+namespace { // internal only
+
+class EndgameTests : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		constants_initialize();
+	}
+};
+
+static PosEvaluation eval_fen(const char *fen)
+{
+    Side side_to_move;
+    Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+    return eval_position(side_to_move, pos);
+}
+
+TEST_F(EndgameTests, TestThat_MaterialKey_CountsPieces)
+{
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    ASSERT_EQ(8, material_keys::count(pos.material_key, pieces::WHITE_PAWN));
+    ASSERT_EQ(8, material_keys::count(pos.material_key, pieces::BLACK_PAWN));
+    ASSERT_EQ(2, material_keys::count(pos.material_key, pieces::BLACK_KNIGHT));
+    ASSERT_EQ(1, material_keys::count(pos.material_key, pieces::WHITE_QUEEN));
+    ASSERT_EQ(0, material_keys::count(pos.material_key, pieces::WHITE_KING));
+
+    // The same material anywhere has the same key.
+    Position moved = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N4p/PPPBBPPP/R2QK2R w KQkq -");
+    ASSERT_EQ(pos.material_key, moved.material_key);
+    ASSERT_NE(pos.hash_key, moved.hash_key);
+
+    Position fewer = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N4p/PPPBBPPP/R3K2R w KQkq -");
+    ASSERT_NE(pos.material_key, fewer.material_key);
+}
+
+TEST_F(EndgameTests, TestThat_Kpk_IsWonOnlyWhenTheoreticallyWon)
+{
+    // King on the sixth in front of the pawn wins, whoever's to move.
+    ASSERT_GE(eval_fen("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"), evals::KNOWN_WIN);
+    ASSERT_LE(eval_fen("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1"), -evals::KNOWN_WIN);
+    // But not with a rook's pawn.
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("k7/8/K7/P7/8/8/8/8 w - - 0 1"));
+    // The defending king in front of the pawn.
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("8/8/8/4k3/8/8/4P3/4K3 w - - 0 1"));
+    // The rule of the square.
+    ASSERT_GE(eval_fen("7k/8/8/8/P7/8/8/7K w - - 0 1"), evals::KNOWN_WIN);
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("3k4/8/8/8/P7/8/8/7K w - - 0 1"));
+    // The same, for black.
+    ASSERT_GE(eval_fen("8/8/8/8/4p3/4k3/8/4K3 b - - 0 1"), evals::KNOWN_WIN);
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("7k/8/8/p7/8/8/8/3K4 b - - 0 1"));
+}
+
+TEST_F(EndgameTests, TestThat_Kxk_DrivesKingToEdge)
+{
+    // The kings are the same distance apart.
+    PosEvaluation centre = eval_fen("8/8/8/3k4/8/4K3/8/R7 w - - 0 1");
+    PosEvaluation edge   = eval_fen("8/8/8/8/8/4K3/8/R1k5 w - - 0 1");
+    ASSERT_GE(centre, evals::KNOWN_WIN);
+    ASSERT_GT(edge, centre);
+
+    // Bishop and knight: only the corner the bishop covers will do. The bishop's on a dark square.
+    PosEvaluation right_corner = eval_fen("7k/8/5K2/8/8/8/8/2B1N3 w - - 0 1");
+    PosEvaluation wrong_corner = eval_fen("k7/8/2K5/8/8/8/8/2B1N3 w - - 0 1");
+    ASSERT_GE(wrong_corner, evals::KNOWN_WIN);
+    ASSERT_GT(right_corner, wrong_corner);
+
+    // Not enough to mate.
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("3k4/8/8/8/8/8/8/1N2K3 w - - 0 1"));
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("3k4/8/8/8/8/8/8/1N2KN2 w - - 0 1"));
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("3k4/8/8/8/8/4B3/8/2B1K3 b - - 0 1"));
+    ASSERT_LE(eval_fen("3k4/8/8/8/8/8/8/2B1KB2 b - - 0 1"), -evals::KNOWN_WIN);
+}
+
+TEST_F(EndgameTests, TestThat_WrongBishop_IsDrawn)
+{
+    // a8 is a light square.
+    ASSERT_EQ(evals::DRAW_SCORE, eval_fen("k7/8/8/8/8/P7/8/2B1K3 w - - 0 1"));
+    ASSERT_GT(eval_fen("k7/8/8/8/8/P7/8/3BK3 w - - 0 1"), 0);
+    // The king has to be there in time.
+    ASSERT_GT(eval_fen("8/8/8/8/4k3/P7/8/2B1K3 w - - 0 1"), 0);
+}
+
+TEST_F(EndgameTests, TestThat_OppositeBishops_AreScaledTowardsDraw)
+{
+    Position opposite = fen::parse_fen("4k3/8/8/3b4/8/8/3B1PPP/4K1N1 w - - 0 1");
+    ASSERT_FALSE(has_endgame_knowledge(opposite));
+
+    opposite = fen::parse_fen("4k3/6pp/8/3b4/8/8/3B1PPP/4K3 w - - 0 1");
+    Position same = fen::parse_fen("4k3/6pp/8/4b3/8/8/3B1PPP/4K3 w - - 0 1");
+    ASSERT_TRUE(has_endgame_knowledge(opposite));
+    ASSERT_FALSE(has_endgame_knowledge(same));
+    ASSERT_LT(abs(eval_position(sides::white, opposite)), abs(eval_position(sides::white, same)));
+}
+
+} //anonymous namespace
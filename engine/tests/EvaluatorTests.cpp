@@ -0,0 +1,304 @@
+#include <engine/Evaluator.hpp>
+#include <engine/PawnHash.hpp>
+#include <engine/EvalCache.hpp>
+#include <engine/EvalTrace.hpp>
+#include <engine/Material.hpp>
+#include <engine/Position.hpp>
+#include <fen_parser/FenParser.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace chess;
+using namespace std;
+
+namespace { // internal only
+
+class EvaluatorTests : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		constants_initialize();
+	}
+};
+
+TEST_F(EvaluatorTests, TestThat_Pawns_PassedPawnAndAttackSpansAreFound)
+{
+    Position pos = fen::parse_fen("4k3/8/8/3P4/8/8/8/4K3 w - - 0 1");
+
+    PawnEntry entry;
+    evaluate_pawns(pos, entry);
+
+    ASSERT_EQ(squarebits::d5, entry.passed[sides::white]);
+    ASSERT_EQ(util::nil, entry.passed[sides::black]);
+    ASSERT_EQ(squarebits::c6 | squarebits::e6, entry.attacks[sides::white]);
+    ASSERT_EQ(squarebits::c6 | squarebits::c7 | squarebits::c8 | squarebits::e6 | squarebits::e7 | squarebits::e8, entry.attack_spans[sides::white]);
+    ASSERT_EQ(evals::PASSED_PAWN_BONUS[ranks::fifth] + evals::ISOLATED_PAWN_PENALTY, entry.score);
+}
+
+TEST_F(EvaluatorTests, TestThat_Pawns_DoubledAndIsolatedArePenalised)
+{
+    Position pos = fen::parse_fen("4k3/8/8/8/8/2P5/2P5/4K3 w - - 0 1");
+
+    PawnEntry entry;
+    evaluate_pawns(pos, entry);
+
+    ASSERT_EQ(squarebits::c2 | squarebits::c3, entry.passed[sides::white]);
+    ASSERT_EQ(2 * evals::ISOLATED_PAWN_PENALTY + evals::DOUBLED_PAWN_PENALTY +
+              evals::PASSED_PAWN_BONUS[ranks::second] + evals::PASSED_PAWN_BONUS[ranks::third], entry.score);
+}
+
+TEST_F(EvaluatorTests, TestThat_Pawns_BackwardPawnIsPenalised)
+{
+    // d3 can't advance past c5, and e4 is too far forward to help it. e4 is passed; c5 is isolated.
+    Position pos = fen::parse_fen("4k3/8/8/2p5/4P3/3P4/8/4K3 w - - 0 1");
+
+    PawnEntry entry;
+    evaluate_pawns(pos, entry);
+
+    ASSERT_EQ(squarebits::e4, entry.passed[sides::white]);
+    ASSERT_EQ(evals::BACKWARD_PAWN_PENALTY + evals::PASSED_PAWN_BONUS[ranks::fourth] - evals::ISOLATED_PAWN_PENALTY, entry.score);
+}
+
+TEST_F(EvaluatorTests, TestThat_Pawns_CandidatePasserIsFound)
+{
+    // c4 has only d6 in its way, and b3 to support it. b3 is passed; d6 is isolated.
+    Position pos = fen::parse_fen("4k3/8/3p4/8/2P5/1P6/8/4K3 w - - 0 1");
+
+    PawnEntry entry;
+    evaluate_pawns(pos, entry);
+
+    ASSERT_EQ(squarebits::b3, entry.passed[sides::white]);
+    ASSERT_EQ(evals::CANDIDATE_PASSER_BONUS[ranks::fourth] + evals::PASSED_PAWN_BONUS[ranks::third] - evals::ISOLATED_PAWN_PENALTY, entry.score);
+}
+
+TEST_F(EvaluatorTests, TestThat_PawnHash_HitsOnSamePawnsAndMatchesFullEvaluation)
+{
+    PawnHashTable table(1 << 8);
+
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    Position same_pawns = fen::parse_fen("r3k2r/p1ppqpb1/b3pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R2K3R b kq -");
+
+    PawnEntry full;
+    evaluate_pawns(pos, full);
+
+    const PawnEntry &first = table.probe(pos);
+    ASSERT_EQ(1u, table.probes);
+    ASSERT_EQ(0u, table.hits);
+    ASSERT_EQ(full.score, first.score);
+    ASSERT_EQ(0, memcmp(full.passed, first.passed, sizeof(full.passed)));
+    ASSERT_EQ(0, memcmp(full.attack_spans, first.attack_spans, sizeof(full.attack_spans)));
+
+    const PawnEntry &second = table.probe(same_pawns);
+    ASSERT_EQ(2u, table.probes);
+    ASSERT_EQ(1u, table.hits);
+    ASSERT_EQ(&first, &second);
+}
+
+TEST_F(EvaluatorTests, TestThat_Eval_IsSymmetricForMirroredPosition)
+{
+    const pair<const char *, const char *> fens[] =
+    {
+        { "4k3/8/8/2p5/4P3/3P4/8/4K3 w - - 0 1",         "4k3/8/3p4/4p3/2P5/8/8/4K3 b - - 0 1" },
+        { "6k1/5ppp/4p3/8/3P4/8/PP3PPP/6K1 w - - 0 1",   "6k1/pp3ppp/8/3p4/8/4P3/5PPP/6K1 b - - 0 1" },
+    };
+
+    for (auto fen_pair : fens)
+    {
+        Position pos      = fen::parse_fen(fen_pair.first);
+        Position mirrored = fen::parse_fen(fen_pair.second);
+
+        ASSERT_EQ(eval_position(sides::white, pos), eval_position(sides::black, mirrored));
+    }
+}
+
+// Flip the board vertically and swap the colours of all the pieces.
+static Position mirror_position(const Position &pos)
+{
+    Position mirrored;
+    for (Square square = 0; square < util::NUM_SQUARES; ++square)
+    {
+        Piece piece = pos.squares[square];
+        if (piece != pieces::NONE)
+            mirrored.place_piece(get_piece_side(piece) == sides::white ? piece + 1 : piece - 1, square ^ 56);
+    }
+    mirrored.update_sides();
+    mirrored.recompute_incremental_evals();
+    return mirrored;
+}
+
+TEST_F(EvaluatorTests, TestThat_Eval_IsSymmetricWithPiecesAttackingEachOther)
+{
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+        "r1b2rk1/pp3ppp/2n5/3qN3/3P4/2PB4/P4PPP/R2QR1K1 b - - 0 1",
+        "6k1/5p1p/4nQp1/8/8/6P1/5PBP/3r2K1 w - - 0 1",
+    };
+
+    for (auto fen : fens)
+    {
+        Position pos      = fen::parse_fen(fen);
+        Position mirrored = mirror_position(pos);
+
+        ASSERT_EQ(eval_position(sides::white, pos), eval_position(sides::black, mirrored));
+        ASSERT_EQ(eval_position(sides::black, pos), eval_position(sides::white, mirrored));
+        ASSERT_EQ(eval_position(sides::white, pos), -eval_position(sides::black, pos));
+    }
+}
+
+TEST_F(EvaluatorTests, TestThat_EvalCache_ReturnsWhatWasStored)
+{
+    EvalCache cache(1024);
+    PosEvaluation eval;
+
+    ASSERT_FALSE(cache.probe(0x1234567812345678, eval));
+
+    cache.store(0x1234567812345678, -250);
+    ASSERT_TRUE(cache.probe(0x1234567812345678, eval));
+    ASSERT_EQ(-250, eval);
+
+    // Same slot, different key
+    ASSERT_FALSE(cache.probe(0x1234567812345678 ^ 0x0000010000000000, eval));
+    ASSERT_EQ(3u, cache.probes.load());
+    ASSERT_EQ(1u, cache.hits.load());
+
+    cache.resize(0);
+    cache.store(0x1234567812345678, -250);
+    ASSERT_FALSE(cache.probe(0x1234567812345678, eval));
+}
+
+TEST_F(EvaluatorTests, TestThat_Eval_IsSameWithAndWithoutCache)
+{
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+
+    EvalCache &cache = get_eval_cache();
+    cache.clear();
+
+    PosEvaluation white_eval = eval_position(sides::white, pos);
+    PosEvaluation black_eval = eval_position(sides::black, pos);
+    ASSERT_EQ(0u, cache.hits.load());
+
+    ASSERT_EQ(white_eval, eval_position(sides::white, pos));
+    ASSERT_EQ(black_eval, eval_position(sides::black, pos));
+    ASSERT_EQ(2u, cache.hits.load());
+
+    size_t bytes = cache.size_in_bytes();
+    cache.resize(0);
+    ASSERT_EQ(white_eval, eval_position(sides::white, pos));
+    ASSERT_EQ(black_eval, eval_position(sides::black, pos));
+    cache.resize(bytes);
+}
+
+TEST_F(EvaluatorTests, TestThat_LazyEval_StopsEarlyOnlyOutsideWindow)
+{
+    // White is a queen up, so nothing but material matters against a window around zero.
+    Position pos = fen::parse_fen("r1b1kbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 0 1");
+
+    EvalCache &cache = get_eval_cache();
+    cache.clear();
+
+    PosEvaluation full_eval = eval_position(sides::white, pos);
+    cache.clear();
+
+    uint64_t counts[NUM_EVAL_STAGES];
+    reset_eval_stage_counts();
+    PosEvaluation lazy_eval = eval_position(sides::white, pos, -50, 50);
+    get_eval_stage_counts(counts);
+    ASSERT_EQ(1u, counts[EVAL_STAGE_MATERIAL]);
+    ASSERT_GE(lazy_eval, 50);
+
+    // Lazy results aren't cached, so the full eval still has to be worked out.
+    ASSERT_EQ(full_eval, eval_position(sides::white, pos, full_eval - 1, full_eval + 1));
+    get_eval_stage_counts(counts);
+    ASSERT_EQ(1u, counts[EVAL_STAGE_FULL]);
+    ASSERT_EQ(0u, cache.hits.load());
+}
+
+TEST_F(EvaluatorTests, TestThat_MaterialTable_MatchesFullCalculation)
+{
+    const char *fens[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "4k3/8/3p4/8/2P5/1P6/8/4K3 w - - 0 1",
+        "3k4/8/8/8/8/8/8/2B1KN2 w - - 0 1",
+        // Not in the table: two queens, and three knights.
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKQNR w KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/1NN1KN2 w - - 0 1",
+    };
+
+    for (auto fen : fens)
+    {
+        Position pos = fen::parse_fen(fen);
+
+        int counts[13] = {};
+        int phase      = 0;
+        for (Square square = 0; square < util::NUM_SQUARES; ++square)
+        {
+            ++counts[pos.squares[square]];
+            phase += evals::PHASE_WEIGHTS[pos.squares[square]];
+        }
+
+        MaterialEntry expected, overflow;
+        evaluate_material(counts, expected);
+        const MaterialEntry &entry = probe_material(pos, overflow);
+
+        ASSERT_EQ(expected.imbalance, entry.imbalance);
+        ASSERT_EQ(std::min(phase, evals::TOTAL_PHASE), entry.phase);
+        ASSERT_EQ(expected.endgame.evaluation, entry.endgame.evaluation);
+        ASSERT_EQ(expected.endgame.strong_side, entry.endgame.strong_side);
+    }
+}
+
+TEST_F(EvaluatorTests, TestThat_EvalTrace_AddsUpToEval)
+{
+    const char *fens[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r1b2rk1/pp3ppp/2n5/3qN3/3P4/2PB4/P4PPP/R2QR1K1 b - - 0 1",
+        "4k3/8/3p4/8/2P5/1P6/8/4K3 w - - 0 1",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+    };
+
+    Score weights[eval_terms::NUM_TERMS];
+    get_eval_weights(weights);
+
+    for (auto fen : fens)
+    {
+        Position pos = fen::parse_fen(fen);
+
+        EvalTrace trace;
+        PosEvaluation eval = trace_evaluation(pos, trace);
+
+        ASSERT_EQ(eval_position(sides::white, pos), eval);
+        ASSERT_EQ(eval, evaluate_trace(trace, weights));
+    }
+}
+
+TEST_F(EvaluatorTests, TestThat_TermGroups_AddUpToTrace)
+{
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+
+    Score weights[eval_terms::NUM_TERMS];
+    get_eval_weights(weights);
+
+    EvalTrace trace;
+    PosEvaluation eval = trace_evaluation(pos, trace);
+
+    Score groups[NUM_TERM_GROUPS];
+    get_term_group_scores(trace, weights, groups);
+
+    // Material isn't tapered, so has the same middlegame and endgame value.
+    Score tapered = 0;
+    for (int group = TERMS_MATERIAL + 1; group < NUM_TERM_GROUPS; ++group)
+        tapered += groups[group];
+    PosEvaluation material = mg_value(groups[TERMS_MATERIAL]);
+    ASSERT_EQ(material, eg_value(groups[TERMS_MATERIAL]));
+    ASSERT_EQ(eval, material + (mg_value(tapered) * trace.phase + eg_value(tapered) * (evals::TOTAL_PHASE - trace.phase)) / evals::TOTAL_PHASE);
+    ASSERT_EQ(trace.untuned, groups[TERMS_IMBALANCE] + groups[TERMS_KING_DANGER]);
+}
+
+}
@@ -1,9 +1,11 @@
 #include "../MoveGenerator.hpp"
 #include "../Position.hpp"
+#include <fen_parser/FenParser.hpp>
 
 #include <gtest/gtest.h>
 
 #include <algorithm>
+#include <random>
 
 using namespace chess;
 using namespace chess::squares;
@@ -1092,6 +1094,392 @@ TEST_F(MoveGeneratorTests, TestThat_GenerateAllMoves_WorksForStartingPosition)
     CheckMovesDestinationVarying(moves, squares::g1, pieces::WHITE_KNIGHT, pieces::NONE, { f3, h3 });
 }
 
+//******************************************************************************************************************************************
+//******************************************************************************************************************************************
+//******************************************************************************************************************************************
+//***************************************************** LEGAL MOVE DETECTION ***************************************************************
+//******************************************************************************************************************************************
+//******************************************************************************************************************************************
+//******************************************************************************************************************************************
+
+TEST_F(MoveGeneratorTests, TestThat_HasAnyLegalMove_IsTrueForStartingPosition)
+{
+    position.setup_starting_position();
+
+    ASSERT_TRUE(has_any_legal_move(position, sides::white));
+    ASSERT_TRUE(has_any_legal_move(position, sides::black));
+}
+
+TEST_F(MoveGeneratorTests, TestThat_HasAnyLegalMove_IsFalseWhenStalemated)
+{
+    SetBlackKingAt(position, h8);
+    SetWhiteQueenAt(position, g6);
+    SetWhiteKingAt(position, f7);
+
+    ASSERT_FALSE(has_any_legal_move(position, sides::black));
+    ASSERT_TRUE(has_any_legal_move(position, sides::white));
+}
+
+TEST_F(MoveGeneratorTests, TestThat_HasAnyLegalMove_IsFalseWhenMated)
+{
+    SetBlackKingAt(position, g8);
+    SetBlackPawnAt(position, f7);
+    SetBlackPawnAt(position, g7);
+    SetBlackPawnAt(position, h7);
+    SetWhiteRookAt(position, d8);
+    SetWhiteKingAt(position, g1);
+
+    ASSERT_FALSE(has_any_legal_move(position, sides::black));
+}
+
+TEST_F(MoveGeneratorTests, TestThat_HasAnyLegalMove_FindsMoveAlongPinLine)
+{
+    // King boxed in by the knight, so the only legal move is the pinned bishop capturing along the pin.
+    SetWhiteKingAt(position, a1);
+    SetWhiteBishopAt(position, b2);
+    SetBlackBishopAt(position, d4);
+    SetBlackKingAt(position, h8);
+    position.place_piece(pieces::BLACK_KNIGHT, c3);
+    position.update_sides();
+
+    ASSERT_TRUE(has_any_legal_move(position, sides::white));
+}
+
+TEST_F(MoveGeneratorTests, TestThat_HasAnyLegalMove_IgnoresPinnedPieceThatCannotLeaveThePin)
+{
+    // The knight is pinned, and can never move along a line. King is boxed in by the rooks.
+    SetWhiteKingAt(position, a1);
+    SetWhiteKnightAt(position, c3);
+    SetBlackBishopAt(position, e5);
+    SetBlackRookAt(position, h2);
+    SetBlackRookAt(position, b8);
+    SetBlackKingAt(position, h8);
+
+    ASSERT_FALSE(has_any_legal_move(position, sides::white));
+}
+
+// The moves that make_move accepts, in a canonical order.
+static std::vector<Move::MoveData> legal_moves(const Position &position, const MoveVector &moves)
+{
+    std::vector<Move::MoveData> legal;
+    for (uint32_t i = 0; i < moves.size; ++i)
+    {
+        Position test(position);
+        if (test.make_move(moves[i]))
+            legal.push_back(moves[i].data);
+    }
+    std::sort(legal.begin(), legal.end());
+    return legal;
+}
+
+TEST_F(MoveGeneratorTests, TestThat_GenerateEvasions_FindsTheSameLegalMovesAsGenerateAllMoves)
+{
+    const char *fens[] =
+    {
+        "4k3/8/8/8/1b6/8/2P5/4K2R w K - 0 1",        // Block with the pawn; can't castle out of check
+        "4k3/8/8/8/8/5n2/3B4/R3K3 w Q - 0 1",        // Knight check: take it or step away
+        "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",         // Checking pawn taken en passant
+        "4k3/8/8/8/8/8/r7/r3K3 w - - 0 1",           // Rook check along the back rank, king can't stay on it
+        "3rk3/8/8/8/8/8/3Q4/r2K4 w - - 0 1",         // Queen pinned on the file can't take the checker
+        "K6r/5P2/8/8/8/8/8/6k1 w - - 0 1",           // Promotions that block
+        "r3k2r/p1ppqpb1/bn1Npnp1/3P4/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+    };
+
+    for (auto fen : fens)
+    {
+        Side side;
+        Position pos = fen::parse_fen(fen, nullptr, &side);
+        ASSERT_TRUE(pos.checkers(side) != util::nil) << fen;
+
+        MoveVector all, evasions;
+        generate_all_moves(all, pos, side);
+        generate_evasions(evasions, pos, side);
+
+        ASSERT_LT(evasions.size, all.size) << fen;
+        ASSERT_EQ(legal_moves(pos, all), legal_moves(pos, evasions)) << fen;
+    }
+}
+
+TEST_F(MoveGeneratorTests, TestThat_GenerateEvasions_OnlyMovesTheKing_InDoubleCheck)
+{
+    // The rook checks along the file and the knight from f3; the bishop could take either, but not both.
+    Side side;
+    Position pos = fen::parse_fen("4r1k1/8/8/8/8/5n2/6B1/4K3 w - - 0 1", nullptr, &side);
+
+    MoveVector evasions;
+    generate_evasions(evasions, pos, side);
+
+    ASSERT_GT(evasions.size, 0u);
+    for (uint32_t i = 0; i < evasions.size; ++i)
+    {
+        ASSERT_EQ(pieces::WHITE_KING, evasions[i].get_piece());
+        Position test(pos);
+        ASSERT_TRUE(test.make_move(evasions[i]));
+    }
+}
+
+TEST_F(MoveGeneratorTests, TestThat_GenerateQuietChecks_FindsEveryQuietMoveThatGivesCheck)
+{
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "4k3/8/8/8/8/8/8/R3K2R w KQ - 0 1",
+        "3k4/8/3P4/8/8/3R4/8/4K3 w - - 0 1",         // Discovered checks by the pawn can't go along the file
+        "7k/8/5N2/8/3B4/8/1K6/8 w - - 0 1",          // Knight uncovering the bishop
+        "8/8/8/8/k2P3R/8/8/4K3 w - - 0 1",           // Pawn push uncovering the rook along the rank
+        "3k4/8/8/8/3K4/8/8/3R4 w - - 0 1",           // King stepping off the rook's file
+        "8/2k5/8/8/8/8/4P3/3K4 w - - 0 1",           // Double pawn push giving check
+    };
+
+    for (auto fen : fens)
+    {
+        Side side;
+        Position pos = fen::parse_fen(fen, nullptr, &side);
+        Side other_side = swap_side(side);
+
+        MoveVector all;
+        generate_all_moves(all, pos, side);
+        std::vector<Move::MoveData> expected;
+        for (uint32_t i = 0; i < all.size; ++i)
+        {
+            Move move = all[i];
+            if (move.get_captured_piece() != pieces::NONE || move.get_promotion_piece() != pieces::NONE ||
+                move.get_castling() != moves::CASTLING_NONE)
+                continue;
+
+            Position test(pos);
+            if (test.make_move(move) && test.checkers(other_side))
+                expected.push_back(move.data);
+        }
+        std::sort(expected.begin(), expected.end());
+
+        MoveVector checks;
+        generate_quiet_checks(checks, pos, side);
+        ASSERT_EQ(expected, legal_moves(pos, checks)) << fen;
+    }
+}
+
+static void check_gives_check(const Position &pos, Side side, int depth)
+{
+    MoveVector moves;
+    generate_all_moves(moves, pos, side);
+    for (uint32_t i = 0; i < moves.size; ++i)
+    {
+        Position test(pos);
+        if (!test.make_move(moves[i]))
+            continue;
+
+        ASSERT_EQ(test.checkers(swap_side(side)) != util::nil, gives_check(pos, moves[i]));
+        if (depth > 1)
+            check_gives_check(test, swap_side(side), depth - 1);
+    }
+}
+
+TEST_F(MoveGeneratorTests, TestThat_GivesCheck_AgreesWithMakingTheMove)
+{
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "5k2/8/8/8/8/8/8/4K2R w K - 0 1",            // Castling, the rook checking along the file
+        "8/8/8/R2pP2k/8/8/8/4K3 w - d6 0 1",         // En passant uncovering the rook along the rank
+        "8/8/4K3/8/8/8/4p3/k7 b - - 0 1",            // Promoting, the queen checking back past the pawn's square
+    };
+
+    for (auto fen : fens)
+    {
+        SCOPED_TRACE(fen);
+        Side side;
+        Position pos = fen::parse_fen(fen, nullptr, &side);
+        check_gives_check(pos, side, 2);
+    }
+}
 
+TEST_F(MoveGeneratorTests, TestThat_IsPseudoLegalAndIsLegal_AgreeWithTheGeneratorOnRandomMoves)
+{
+    const char *fens[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    };
+
+    std::mt19937 random(12345);
+    std::vector<Move> pool; // Moves from earlier positions, which mostly won't fit the current one
+    const size_t POOL_SIZE = 512;
+    const int    PLIES     = 40;
+
+    for (auto fen : fens)
+    {
+        Side side;
+        Position pos = fen::parse_fen(fen, nullptr, &side);
+
+        for (int ply = 0; ply < PLIES; ++ply)
+        {
+            MoveVector generated[2];
+            std::vector<Move::MoveData> sorted[2];
+            for (Side s = sides::white; s <= sides::black; ++s)
+            {
+                generate_all_moves(generated[s], pos, s);
+                for (uint32_t i = 0; i < generated[s].size; ++i)
+                    sorted[s].push_back(generated[s][i].data);
+                std::sort(sorted[s].begin(), sorted[s].end());
+            }
+
+            // The stored moves, this position's own, and both with a field or two scrambled.
+            std::vector<Move> candidates(pool);
+            for (uint32_t i = 0; i < generated[side].size; ++i)
+                candidates.push_back(generated[side][i]);
+            size_t unscrambled = candidates.size();
+            for (size_t i = 0; i < unscrambled; ++i)
+            {
+                Move move = candidates[i];
+                move.data ^= 1u << (random() % 32);
+                if (random() % 2)
+                    move.data ^= 1u << (random() % 32);
+                candidates.push_back(move);
+            }
+
+            for (Move move : candidates)
+            {
+                Piece piece    = move.get_piece();
+                bool  expected = piece != pieces::NONE && piece <= pieces::BLACK_QUEEN &&
+                                 std::binary_search(sorted[get_piece_side(piece)].begin(), sorted[get_piece_side(piece)].end(), move.data);
+                ASSERT_EQ(expected, is_pseudo_legal(pos, move)) << fen << ", ply " << ply << ", move " << std::hex << move.data;
+
+                if (expected)
+                {
+                    Position test(pos);
+                    ASSERT_EQ(test.make_move(move), is_legal(pos, move)) << fen << ", ply " << ply << ", move " << std::hex << move.data;
+                }
+            }
+
+            // Carry on down a random line, remembering some of the moves on the way.
+            std::vector<Move> legal;
+            for (uint32_t i = 0; i < generated[side].size; ++i)
+            {
+                Position test(pos);
+                if (test.make_move(generated[side][i]))
+                    legal.push_back(generated[side][i]);
+                if (pool.size() < POOL_SIZE)
+                    pool.push_back(generated[side][i]);
+                else
+                    pool[random() % POOL_SIZE] = generated[side][i];
+            }
+            if (legal.empty())
+                break;
+
+            pos.make_move(legal[random() % legal.size()]);
+            side = swap_side(side);
+        }
+    }
 }
 
+TEST_F(MoveGeneratorTests, TestThat_Move16_DecodesBackToTheGeneratedMoves_AndToNothingElsePseudoLegal)
+{
+    const char *fens[] =
+    {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+    };
+
+    ASSERT_EQ(2u, sizeof(Move16));
+
+    for (auto fen : fens)
+    {
+        SCOPED_TRACE(fen);
+        Position pos = fen::parse_fen(fen);
+
+        std::vector<Move::MoveData> generated;
+        for (Side side = sides::white; side <= sides::black; ++side)
+        {
+            MoveVector moves;
+            generate_all_moves(moves, pos, side);
+            for (uint32_t i = 0; i < moves.size; ++i)
+            {
+                ASSERT_EQ(moves[i].data, decode_move(pos, Move16(moves[i])).data);
+                generated.push_back(moves[i].data);
+            }
+        }
+        std::sort(generated.begin(), generated.end());
+
+        // As from a hash table: whatever the bits, the decoded move is either rejected or one that would be generated.
+        for (uint32_t bits = 0; bits <= 0xffff; ++bits)
+        {
+            Move16 compact;
+            compact.data = Move16::MoveData(bits);
+            Move move = decode_move(pos, compact);
+            if (is_pseudo_legal(pos, move))
+            {
+                ASSERT_TRUE(std::binary_search(generated.begin(), generated.end(), move.data)) << std::hex << bits;
+            }
+        }
+    }
+}
+
+TEST_F(MoveGeneratorTests, TestThat_CoordinateText_ParsesBackToTheGeneratedLegalMoves_IncludingEpCastlingAndPromotions)
+{
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b KQkq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1",
+        "4k3/8/8/8/3pP3/8/8/4K3 b - e3 0 1",
+        "4k3/8/8/8/8/8/1p6/R3K3 b - - 0 1",
+    };
+
+    for (auto fen : fens)
+    {
+        SCOPED_TRACE(fen);
+        Side side;
+        Position pos = fen::parse_fen(fen, nullptr, &side);
+
+        MoveVector moves;
+        generate_moves(moves, pos, side);
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            Move move = moves[i];
+            char text[6] = {};
+            text[0] = char('a' + move.get_source() % 8);
+            text[1] = char('1' + square_to_rank(move.get_source()));
+            text[2] = char('a' + move.get_destination() % 8);
+            text[3] = char('1' + square_to_rank(move.get_destination()));
+            if (move.get_promotion_piece() != pieces::NONE)
+                text[4] = "???kkrrnnbbqq"[move.get_promotion_piece()];
+
+            Move parsed = parse_coordinate_move(pos, side, text);
+            if (is_legal(pos, move))
+            {
+                ASSERT_EQ(move.data, parsed.data) << text;
+                Position copy = pos;
+                ASSERT_TRUE(copy.make_move(parsed)) << text;
+            }
+            else
+            {
+                ASSERT_EQ(0u, parsed.data) << text;
+            }
+        }
+    }
+
+    Position ep = fen::parse_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    Move move = parse_coordinate_move(ep, sides::white, "e5d6\n");
+    ASSERT_NE(pieces::NONE, move.get_en_passant());
+    ASSERT_EQ(pieces::BLACK_PAWN, move.get_captured_piece());
+
+    ASSERT_EQ(0u, parse_coordinate_move(ep, sides::white, "e5e6q").data);   // Not a promotion
+    ASSERT_EQ(0u, parse_coordinate_move(ep, sides::white, "e1e9").data);    // Off the board
+    ASSERT_EQ(0u, parse_coordinate_move(ep, sides::white, "d5d4").data);    // The other side's pawn
+    ASSERT_EQ(0u, parse_coordinate_move(ep, sides::white, "").data);
+}
+
+}
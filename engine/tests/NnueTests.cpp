@@ -0,0 +1,130 @@
+#include <engine/Nnue.hpp>
+#include <engine/Position.hpp>
+#include <engine/MoveGenerator.hpp>
+#include <engine/Search.hpp>
+#include <fen_parser/FenParser.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+using namespace chess;
+using namespace std;
+
+namespace { // internal only
+
+class NnueTests : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		constants_initialize();
+		nnue::init_random_network(1);
+	}
+};
+
+// Every accumulator reached by update() must be identical to one built from scratch.
+static void check_updates(const Position &pos, Side side_to_move, const nnue::Accumulator &accumulator, int depth)
+{
+    MoveVector moves;
+    generate_all_moves(moves, pos, side_to_move);
+    for (uint32_t i = 0; i < moves.size; ++i)
+    {
+        Position child = pos;
+        if (!child.make_move(moves[i]))
+            continue;
+
+        nnue::Accumulator updated, refreshed;
+        updated.update(accumulator, moves[i]);
+        refreshed.refresh(child);
+        ASSERT_EQ(0, memcmp(updated.values, refreshed.values, sizeof(updated.values)));
+
+        if (depth > 1)
+            check_updates(child, swap_side(side_to_move), updated, depth - 1);
+    }
+}
+
+TEST_F(NnueTests, TestThat_IncrementalUpdate_MatchesRefresh)
+{
+    // Castling both ways, en passant, captures, and promotions with and without capture.
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+        "8/8/8/2k5/3Pp3/8/8/4K3 b - d3 0 1",
+    };
+
+    for (auto fen : fens)
+    {
+        Side side_to_move;
+        Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+
+        nnue::Accumulator accumulator;
+        accumulator.refresh(pos);
+        check_updates(pos, side_to_move, accumulator, 3);
+    }
+}
+
+TEST_F(NnueTests, TestThat_Kernels_MatchScalar)
+{
+    Position pos = fen::parse_fen("r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8");
+
+    nnue::Accumulator accumulator, scalar;
+    accumulator.refresh(pos);
+    nnue::refresh_scalar(scalar, pos);
+
+    ASSERT_EQ(0, memcmp(accumulator.values, scalar.values, sizeof(accumulator.values)));
+    ASSERT_EQ(nnue::evaluate_scalar(scalar, sides::white), nnue::evaluate(accumulator, sides::white));
+    ASSERT_EQ(nnue::evaluate_scalar(scalar, sides::black), nnue::evaluate(accumulator, sides::black));
+}
+
+TEST_F(NnueTests, TestThat_Eval_IsSymmetricForMirroredPosition)
+{
+    Position pos      = fen::parse_fen("r1b2rk1/pp3ppp/2n5/3qN3/3P4/2PB4/P4PPP/R2QR1K1 b - - 0 1");
+    Position mirrored = fen::parse_fen("r2qr1k1/p4ppp/2pb4/3p4/3Qn3/2N5/PP3PPP/R1B2RK1 w - - 0 1");
+
+    nnue::Accumulator accumulator, mirrored_accumulator;
+    accumulator.refresh(pos);
+    mirrored_accumulator.refresh(mirrored);
+
+    ASSERT_EQ(nnue::evaluate(accumulator, sides::black), nnue::evaluate(mirrored_accumulator, sides::white));
+    ASSERT_EQ(nnue::evaluate(accumulator, sides::white), nnue::evaluate(mirrored_accumulator, sides::black));
+}
+
+TEST_F(NnueTests, TestThat_Network_SurvivesSaveAndLoad)
+{
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -");
+    const char *path = "oink_nnue_test.bin";
+
+    nnue::Accumulator accumulator;
+    accumulator.refresh(pos);
+    PosEvaluation saved_eval = nnue::evaluate(accumulator, sides::white);
+    ASSERT_TRUE(nnue::save_network(path));
+
+    nnue::init_random_network(2);
+    accumulator.refresh(pos);
+    ASSERT_NE(saved_eval, nnue::evaluate(accumulator, sides::white));
+
+    ASSERT_TRUE(nnue::load_network(path));
+    accumulator.refresh(pos);
+    ASSERT_EQ(saved_eval, nnue::evaluate(accumulator, sides::white));
+
+    remove(path);
+    ASSERT_FALSE(nnue::load_network(path));
+}
+
+TEST_F(NnueTests, TestThat_AlphaBeta_And_MiniMax_AgreeUsingNnue)
+{
+    Side side_to_move;
+    Position pos = fen::parse_fen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -", nullptr, &side_to_move);
+
+    // Only depth 2: minimax has to run a full-window quiescence search at every leaf, which is slow on this position.
+    ASSERT_TRUE(set_eval_type(EVAL_NNUE));
+    MoveAndEval ab_result = alpha_beta(side_to_move, pos, 2, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+    MoveAndEval mm_result = minimax(side_to_move, pos, 2);
+    set_eval_type(EVAL_CLASSICAL);
+
+    ASSERT_EQ(mm_result.best_eval, ab_result.best_eval);
+}
+
+} //anonymous namespace
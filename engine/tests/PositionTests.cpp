@@ -1,4 +1,6 @@
 #include <engine/Position.hpp>
+#include <engine/MoveGenerator.hpp>
+#include <fen_parser/FenParser.hpp>
 #include <display/ConsoleDisplay.hpp>
 
 #include <gtest/gtest.h>
@@ -55,4 +57,358 @@ TEST_F(PositionTests, TestThat_get_empty_squares_ReturnsFullBoardForClearBoard)
 	ASSERT_EQ(util::full, position.get_empty_squares());
 }
 
+TEST_F(PositionTests, TestThat_IncrementalEvals_AreAsExpectedForStartingPosition)
+{
+	Position position;
+	position.setup_starting_position();
+
+	ASSERT_TRUE(position.incremental_evals_consistent());
+	ASSERT_EQ(0, position.psq);
+}
+
+TEST_F(PositionTests, TestThat_Scores_PackAndUnpackBothHalves)
+{
+	const PosEvaluation values[] = { 0, 1, -1, 37, -37, 900, -900, 20000, -20000 };
+
+	for (PosEvaluation mg : values)
+	{
+		for (PosEvaluation eg : values)
+		{
+			Score score = make_score(mg, eg);
+			ASSERT_EQ(mg, mg_value(score));
+			ASSERT_EQ(eg, eg_value(score));
+			ASSERT_EQ(mg + 5, mg_value(score + make_score(5, -7)));
+			ASSERT_EQ(eg - 7, eg_value(score + make_score(5, -7)));
+		}
+	}
+}
+
+TEST_F(PositionTests, TestThat_PieceSquareTables_AreMirroredForBlack)
+{
+	for (Square square = 0; square < util::NUM_SQUARES; ++square)
+	{
+		ASSERT_EQ(evals::piece_square[pieces::WHITE_KNIGHT][square], -evals::piece_square[pieces::BLACK_KNIGHT][square ^ 56]);
+		ASSERT_EQ(evals::piece_square[pieces::WHITE_KING][square],   -evals::piece_square[pieces::BLACK_KING][square ^ 56]);
+	}
+}
+
+static void check_incremental_evals_through_tree(const Position &pos, Side side, int depth)
+{
+	MoveVector moves;
+	generate_all_moves(moves, pos, side);
+
+	for (uint32_t i = 0; i < moves.size; ++i)
+	{
+		Position test(pos);
+		if (test.make_move(moves[i]))
+		{
+			ASSERT_TRUE(test.incremental_evals_consistent());
+			if (depth > 1)
+				check_incremental_evals_through_tree(test, swap_side(side), depth - 1);
+		}
+	}
+}
+
+// Kiwipete covers castling and EP; the second position is full of (capturing) promotions.
+TEST_F(PositionTests, TestThat_IncrementalEvals_MatchFullRecalculation)
+{
+	const char *fens[] =
+	{
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+	};
+
+	for (auto fen : fens)
+	{
+		Side side_to_move;
+		Position position = fen::parse_fen(fen, nullptr, &side_to_move);
+		ASSERT_TRUE(position.incremental_evals_consistent());
+
+		check_incremental_evals_through_tree(position, side_to_move, 3);
+	}
+}
+
+TEST_F(PositionTests, TestThat_PawnKey_DependsOnlyOnPawns)
+{
+	Position position;
+	position.setup_starting_position();
+	ASSERT_NE(0u, position.pawn_key);
+
+	// Same pawns, different pieces
+	Position moved_pieces = fen::parse_fen("r1bqkbnr/pppppppp/2n5/8/8/5N2/PPPPPPPP/RNBQKB1R w KQkq - 2 2");
+	ASSERT_EQ(position.pawn_key, moved_pieces.pawn_key);
+
+	Move knight_move;
+	knight_move.set_piece(pieces::WHITE_KNIGHT);
+	knight_move.set_source(squares::g1);
+	knight_move.set_destination(squares::f3);
+	ASSERT_TRUE(position.make_move(knight_move));
+	ASSERT_EQ(moved_pieces.pawn_key, position.pawn_key);
+
+	Move pawn_move;
+	pawn_move.set_piece(pieces::BLACK_PAWN);
+	pawn_move.set_source(squares::e7);
+	pawn_move.set_destination(squares::e5);
+	ASSERT_TRUE(position.make_move(pawn_move));
+	ASSERT_NE(moved_pieces.pawn_key, position.pawn_key);
+	ASSERT_EQ(position.compute_pawn_key(), position.pawn_key);
+
+	Position no_pawns = fen::parse_fen("4k3/8/8/8/8/8/8/4K2R w K - 0 1");
+	ASSERT_EQ(0u, no_pawns.pawn_key);
+}
+
+static Move make_test_move(Piece piece, Square source, Square destination)
+{
+	Move move;
+	move.set_piece(piece);
+	move.set_source(source);
+	move.set_destination(destination);
+	return move;
+}
+
+TEST_F(PositionTests, TestThat_HashKey_IsSameForTranspositions)
+{
+	Position via_king_knight;
+	via_king_knight.setup_starting_position();
+	Position via_queen_knight = via_king_knight;
+
+	ASSERT_TRUE(via_king_knight.make_move(make_test_move(pieces::WHITE_KNIGHT, squares::g1, squares::f3)));
+	ASSERT_TRUE(via_king_knight.make_move(make_test_move(pieces::BLACK_KNIGHT, squares::g8, squares::f6)));
+	ASSERT_TRUE(via_king_knight.make_move(make_test_move(pieces::WHITE_KNIGHT, squares::b1, squares::c3)));
+
+	ASSERT_TRUE(via_queen_knight.make_move(make_test_move(pieces::WHITE_KNIGHT, squares::b1, squares::c3)));
+	ASSERT_TRUE(via_queen_knight.make_move(make_test_move(pieces::BLACK_KNIGHT, squares::g8, squares::f6)));
+	ASSERT_TRUE(via_queen_knight.make_move(make_test_move(pieces::WHITE_KNIGHT, squares::g1, squares::f3)));
+
+	ASSERT_EQ(via_king_knight.hash_key, via_queen_knight.hash_key);
+	ASSERT_EQ(fen::parse_fen("rnbqkb1r/pppppppp/5n2/8/8/2N2N2/PPPPPPPP/R1BQKB1R b KQkq - 3 2").hash_key, via_king_knight.hash_key);
+}
+
+TEST_F(PositionTests, TestThat_HashKey_IncludesCastlingRightsAndEPSquare)
+{
+	Position castling   = fen::parse_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+	Position no_castling = fen::parse_fen("r3k2r/8/8/8/8/8/8/R3K2R w Kkq - 0 1");
+	ASSERT_NE(castling.hash_key, no_castling.hash_key);
+
+	// Moving the rook away and back loses the rights, so isn't the same position.
+	ASSERT_TRUE(castling.make_move(make_test_move(pieces::WHITE_ROOK, squares::a1, squares::a2)));
+	ASSERT_TRUE(castling.make_move(make_test_move(pieces::BLACK_ROOK, squares::a8, squares::a7)));
+	ASSERT_TRUE(castling.make_move(make_test_move(pieces::WHITE_ROOK, squares::a2, squares::a1)));
+	ASSERT_TRUE(castling.make_move(make_test_move(pieces::BLACK_ROOK, squares::a7, squares::a8)));
+	ASSERT_EQ(fen::parse_fen("r3k2r/8/8/8/8/8/8/R3K2R w Kk - 4 3").hash_key, castling.hash_key);
+
+	Position ep    = fen::parse_fen("4k3/8/8/8/4P3/8/8/4K3 b - e3 0 1");
+	Position no_ep = fen::parse_fen("4k3/8/8/8/4P3/8/8/4K3 b - - 0 1");
+	ASSERT_NE(ep.hash_key, no_ep.hash_key);
+}
+
+
+TEST_F(PositionTests, TestThat_StateInfo_FindsChecksAndPins)
+{
+	// The rook on e7 checks white, whose knight on d2 is pinned by the bishop. White's rook pins the knight on c8, and the
+	// knight on g6 blocks the bishop's line to the black king.
+	Position position = fen::parse_fen("R1n1k3/4r3/6N1/7B/1b6/8/3N4/4K3 w - - 0 1");
+	using namespace squares;
+
+	ASSERT_EQ(squarebits::indexed[e7], position.checkers(sides::white));
+	ASSERT_EQ(util::nil, position.checkers(sides::black));
+	ASSERT_TRUE(position.detect_check(sides::white));
+	ASSERT_FALSE(position.detect_check(sides::black));
+
+	ASSERT_EQ(squarebits::indexed[d2], position.pinned(sides::white));
+	ASSERT_EQ(squarebits::indexed[c8], position.pinned(sides::black));
+	ASSERT_EQ(squarebits::indexed[g6], position.discovered_check_candidates(sides::white));
+	ASSERT_EQ(util::nil, position.discovered_check_candidates(sides::black));
+
+	ASSERT_EQ(squarebits::indexed[d7] | squarebits::indexed[f7], position.check_squares(pieces::WHITE_PAWN));
+	ASSERT_EQ(moves::knight_moves[e8], position.check_squares(pieces::WHITE_KNIGHT));
+	ASSERT_EQ(squarebits::indexed[c8] | squarebits::indexed[d8] | squarebits::indexed[f8] | squarebits::indexed[g8] | squarebits::indexed[h8] |
+			  squarebits::indexed[e7], position.check_squares(pieces::WHITE_ROOK));
+	ASSERT_EQ(position.check_squares(pieces::WHITE_ROOK) | position.check_squares(pieces::WHITE_BISHOP), position.check_squares(pieces::WHITE_QUEEN));
+	ASSERT_EQ(util::nil, position.check_squares(pieces::WHITE_KING));
+	ASSERT_EQ(squarebits::indexed[d2] | squarebits::indexed[f2], position.check_squares(pieces::BLACK_PAWN));
+}
+
+// The pieces of a side which, if lifted off the board, would let more of the attacker's pieces through to the king.
+static Bitboard find_line_blockers(const Position &position, Side king_side, Side blocking_side)
+{
+	Square   king_square = get_first_occ_square(position.kings[king_side]);
+	Bitboard attackers   = position.sides[swap_side(king_side)];
+	Bitboard before      = position.attackers_to(king_square, position.whole_board) & attackers;
+
+	Bitboard blockers = util::nil;
+	for (Square square = 0; square < util::NUM_SQUARES; ++square)
+	{
+		Bitboard bit = squarebits::indexed[square];
+		if (!(position.sides[blocking_side] & bit) || (position.kings[blocking_side] & bit))
+			continue;
+		if (position.attackers_to(king_square, position.whole_board ^ bit) & attackers & ~before & ~bit)
+			blockers |= bit;
+	}
+	return blockers;
+}
+
+TEST_F(PositionTests, TestThat_StateInfo_IsRecomputedAfterEachMove)
+{
+	const char *fens[] =
+	{
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	};
+
+	for (auto fen : fens)
+	{
+		Side side_to_move;
+		Position position = fen::parse_fen(fen, nullptr, &side_to_move);
+		// Fill the cache in, to be sure that the children don't end up with any of it.
+		position.pinned(sides::white);
+		position.check_squares(pieces::WHITE_ROOK);
+
+		MoveVector moves;
+		generate_all_moves(moves, position, side_to_move);
+		for (uint32_t i = 0; i < moves.size; ++i)
+		{
+			Position child = position;
+			if (!child.make_move(moves[i]))
+				continue;
+
+			for (Side side = sides::white; side <= sides::black; ++side)
+			{
+				Square king_square = get_first_occ_square(child.kings[side]);
+				ASSERT_EQ(child.attackers_to(king_square, child.whole_board) & child.sides[swap_side(side)], child.checkers(side));
+				ASSERT_EQ(find_line_blockers(child, side, side), child.pinned(side));
+				ASSERT_EQ(find_line_blockers(child, swap_side(side), side), child.discovered_check_candidates(side));
+				ASSERT_EQ(moves::knight_moves[get_first_occ_square(child.kings[swap_side(side)])], child.check_squares(pieces::KNIGHTS[side]));
+			}
+		}
+	}
+}
+
+
+TEST_F(PositionTests, TestThat_AttacksBy_MatchesAttackersOfEachSquare)
+{
+	const char *fens[] =
+	{
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+		"n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+		"1N4n1/8/8/Q6q/8/8/8/K1k5 w - - 0 1",
+	};
+
+	for (auto fen : fens)
+	{
+		Position position = fen::parse_fen(fen);
+		for (Side side = sides::white; side <= sides::black; ++side)
+		{
+			Bitboard expected = util::nil;
+			for (Square square = 0; square < util::NUM_SQUARES; ++square)
+			{
+				if (position.attackers_to(square, position.whole_board) & position.sides[side])
+					expected |= squarebits::indexed[square];
+			}
+			ASSERT_EQ(expected, position.attacks_by(side));
+
+			Bitboard knights = util::nil;
+			for (Square square = 0; square < util::NUM_SQUARES; ++square)
+			{
+				if (position.attackers_to(square, position.whole_board) & position.knights[side])
+					knights |= squarebits::indexed[square];
+			}
+			ASSERT_EQ(knights, position.attacks_by_piece(pieces::KNIGHTS[side]));
+		}
+	}
+}
+
+TEST_F(PositionTests, TestThat_Castling_IsRefusedOutOfOrThroughCheck)
+{
+	Move white_kingside  = make_test_move(pieces::WHITE_KING, squares::e1, squares::g1);
+	Move white_queenside = make_test_move(pieces::WHITE_KING, squares::e1, squares::c1);
+	white_kingside.set_castling(moves::CASTLING_WHITE_KINGSIDE);
+	white_queenside.set_castling(moves::CASTLING_WHITE_QUEENSIDE);
+
+	// The knight covers f1, but none of the queenside squares.
+	Position position = fen::parse_fen("4k3/8/8/8/8/8/7n/R3K2R w KQ - 0 1");
+	ASSERT_FALSE(Position(position).make_move(white_kingside));
+	ASSERT_TRUE(Position(position).make_move(white_queenside));
+
+	// Only b1 is attacked, which the rook crosses but the king doesn't.
+	position = fen::parse_fen("4k3/8/8/8/8/8/p7/R3K2R w KQ - 0 1");
+	ASSERT_TRUE(Position(position).make_move(white_queenside));
+	// Out of check.
+	position = fen::parse_fen("4k3/8/8/8/8/8/3p4/R3K2R w KQ - 0 1");
+	ASSERT_FALSE(Position(position).make_move(white_queenside));
+	ASSERT_FALSE(Position(position).make_move(white_kingside));
+
+	Move black_kingside = make_test_move(pieces::BLACK_KING, squares::e8, squares::g8);
+	black_kingside.set_castling(moves::CASTLING_BLACK_KINGSIDE);
+	position = fen::parse_fen("r3k2r/8/8/8/B7/8/8/4K3 b kq - 0 1");
+	ASSERT_FALSE(Position(position).make_move(black_kingside));
+	// Into check.
+	position = fen::parse_fen("r3k2r/8/8/8/8/8/8/4K1R1 b kq - 0 1");
+	ASSERT_FALSE(Position(position).make_move(black_kingside));
+	position = fen::parse_fen("r3k2r/8/8/8/8/8/8/4K2R b kq - 0 1");
+	ASSERT_TRUE(Position(position).make_move(black_kingside));
+}
+
+TEST_F(PositionTests, TestThat_MoveType_FollowsTheOtherFields)
+{
+	Move move = make_test_move(pieces::WHITE_PAWN, squares::b7, squares::b8);
+	ASSERT_EQ(moves::MOVE_NORMAL, move.get_type());
+
+	// A promotion stays one whether or not it captures, and goes back to the plain type once it's taken off.
+	move.set_promotion_piece(pieces::WHITE_QUEEN);
+	ASSERT_EQ(moves::MOVE_PROMOTION, move.get_type());
+	move.set_captured_piece(pieces::BLACK_ROOK);
+	ASSERT_EQ(moves::MOVE_PROMOTION, move.get_type());
+	move.set_promotion_piece(pieces::NONE);
+	ASSERT_EQ(moves::MOVE_CAPTURE, move.get_type());
+	move.set_captured_piece(pieces::NONE);
+	ASSERT_EQ(moves::MOVE_NORMAL, move.get_type());
+
+	Move ep = make_test_move(pieces::BLACK_PAWN, squares::d4, squares::e3);
+	ep.set_en_passant(pieces::BLACK_PAWN);
+	ep.set_captured_piece(pieces::WHITE_PAWN);
+	ASSERT_EQ(moves::MOVE_EN_PASSANT, ep.get_type());
+	ASSERT_EQ(pieces::BLACK_PAWN, ep.get_en_passant());
+
+	Move castling = make_test_move(pieces::BLACK_KING, squares::e8, squares::c8);
+	castling.set_castling(moves::CASTLING_BLACK_QUEENSIDE);
+	ASSERT_EQ(moves::MOVE_CASTLING, castling.get_type());
+	ASSERT_EQ(moves::CASTLING_BLACK_QUEENSIDE, castling.get_castling());
+	ASSERT_TRUE(castling.is_queenside_castle());
+}
+
+TEST_F(PositionTests, TestThat_CastlingRights_AreLostByMovingOrTakingOnTheirSquares)
+{
+	Position position = fen::parse_fen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+
+	// Taking the rook on h8 loses both sides' kingside rights.
+	Move rook_takes_rook = make_test_move(pieces::WHITE_ROOK, squares::h1, squares::h8);
+	rook_takes_rook.set_captured_piece(pieces::BLACK_ROOK);
+	Position test(position);
+	ASSERT_TRUE(test.make_move(rook_takes_rook));
+	ASSERT_EQ(sides::CASTLING_RIGHTS_WHITE_QUEENSIDE | sides::CASTLING_RIGHTS_BLACK_QUEENSIDE, test.castling_rights);
+	ASSERT_EQ(test.compute_hash_key(), test.hash_key);
+
+	// Any king move, castling included, loses both of that side's.
+	test = position;
+	ASSERT_TRUE(test.make_move(make_test_move(pieces::WHITE_KING, squares::e1, squares::d1)));
+	ASSERT_EQ(sides::CASTLING_RIGHTS_ANY_BLACK, test.castling_rights);
+
+	Move castling = make_test_move(pieces::BLACK_KING, squares::e8, squares::g8);
+	castling.set_castling(moves::CASTLING_BLACK_KINGSIDE);
+	ASSERT_TRUE(test.make_move(castling));
+	ASSERT_EQ(0, test.castling_rights);
+	ASSERT_EQ(pieces::BLACK_ROOK, test.squares[squares::f8]);
+	ASSERT_EQ(test.compute_hash_key(), test.hash_key);
+
+	// A rook moving off its corner loses only that side's rights on its own wing.
+	test = position;
+	ASSERT_TRUE(test.make_move(make_test_move(pieces::WHITE_ROOK, squares::a1, squares::a2)));
+	ASSERT_EQ(sides::CASTLING_RIGHTS_WHITE_KINGSIDE | sides::CASTLING_RIGHTS_ANY_BLACK, test.castling_rights);
+	ASSERT_TRUE(test.make_move(make_test_move(pieces::BLACK_ROOK, squares::a8, squares::b8)));
+	ASSERT_EQ(sides::CASTLING_RIGHTS_WHITE_KINGSIDE | sides::CASTLING_RIGHTS_BLACK_KINGSIDE, test.castling_rights);
+}
+
 }
@@ -1,4 +1,6 @@
 #include <engine/Search.hpp>
+#include <engine/Position.hpp>
+#include <fen_parser/FenParser.hpp>
 
 #include <gtest/gtest.h>
 
@@ -16,8 +18,57 @@ protected:
 	}
 };
 
-TEST_F(SearchTests, TestThatMiniMax_Bla)
+TEST_F(SearchTests, TestThat_AlphaBeta_FindsBackRankMate)
 {
+    Side side_to_move;
+    Position pos = fen::parse_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", nullptr, &side_to_move);
+
+    MoveAndEval result = alpha_beta(side_to_move, pos, 2, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+
+    ASSERT_EQ(squares::a1, result.best_move.get_source());
+    ASSERT_EQ(squares::a8, result.best_move.get_destination());
+    ASSERT_EQ(evals::MATE_SCORE + 1, result.best_eval);
+}
+
+TEST_F(SearchTests, TestThat_AlphaBeta_And_MiniMax_AgreeOnMate)
+{
+    Side side_to_move;
+    Position pos = fen::parse_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", nullptr, &side_to_move);
+
+    MoveAndEval ab_result = alpha_beta(side_to_move, pos, 3, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+    MoveAndEval mm_result = minimax(side_to_move, pos, 3);
+
+    ASSERT_EQ(mm_result.best_eval, ab_result.best_eval);
+    ASSERT_EQ(mm_result.best_move.data, ab_result.best_move.data);
+}
+
+TEST_F(SearchTests, TestThat_Search_SeesMateByCheckJustPastTheHorizon)
+{
+    Side side_to_move;
+    Position pos = fen::parse_fen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", nullptr, &side_to_move);
+
+    // The check is extended, so the main search sees the mate.
+    MoveAndEval result = alpha_beta(side_to_move, pos, 1, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+    ASSERT_EQ(squares::a8, result.best_move.get_destination());
+    ASSERT_EQ(evals::MATE_SCORE + 1, result.best_eval);
+
+    // Black's only move is h4, after which quiescence finds the quiet mate Rg8.
+    pos = fen::parse_fen("k7/P7/1K6/7p/8/8/8/6R1 b - - 0 1", nullptr, &side_to_move);
+
+    result = alpha_beta(side_to_move, pos, 1, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+    ASSERT_EQ(squares::h4, result.best_move.get_destination());
+    ASSERT_EQ(-(evals::MATE_SCORE - 1), result.best_eval);
+}
+
+TEST_F(SearchTests, TestThat_AlphaBeta_ScoresStalemateAsDraw)
+{
+    Side side_to_move;
+    Position pos = fen::parse_fen("7k/5K2/6Q1/8/8/8/8/8 b - - 0 1", nullptr, &side_to_move);
+
+    MoveAndEval result = alpha_beta(side_to_move, pos, 2, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+
+    ASSERT_EQ(0u, result.best_move.data);
+    ASSERT_EQ(evals::DRAW_SCORE, result.best_eval);
 }
 
 } //anonymous namespace
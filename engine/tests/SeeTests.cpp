@@ -0,0 +1,133 @@
+#include <engine/See.hpp>
+#include <engine/Position.hpp>
+#include <engine/MoveGenerator.hpp>
+#include <fen_parser/FenParser.hpp>
+
+#include <gtest/gtest.h>
+
+using namespace chess;
+using namespace std;
+
+namespace { // internal only
+
+class SeeTests : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		constants_initialize();
+	}
+};
+
+// The generated move from one square to another, and promoting to the given piece if any.
+static Move find_move(const Position &pos, Side side, Square source, Square destination, Piece promotion = pieces::NONE)
+{
+    MoveVector moves;
+    generate_all_moves(moves, pos, side);
+    for (uint32_t i = 0; i < moves.size; ++i)
+    {
+        if (moves[i].get_source() == source && moves[i].get_destination() == destination && moves[i].get_promotion_piece() == promotion)
+            return moves[i];
+    }
+
+    ADD_FAILURE() << "Move not found";
+    return Move();
+}
+
+static PosEvaluation value(Piece piece)
+{
+    return abs(evals::PIECE_CAPTURE_VALUES[piece]);
+}
+
+const PosEvaluation PAWN   = value(pieces::WHITE_PAWN);
+const PosEvaluation KNIGHT = value(pieces::WHITE_KNIGHT);
+const PosEvaluation BISHOP = value(pieces::WHITE_BISHOP);
+const PosEvaluation ROOK   = value(pieces::WHITE_ROOK);
+const PosEvaluation QUEEN  = value(pieces::WHITE_QUEEN);
+
+TEST_F(SeeTests, TestThat_See_WinsUndefendedPiece)
+{
+    Position pos = fen::parse_fen("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1");
+    ASSERT_EQ(PAWN, see(pos, find_move(pos, sides::white, squares::e1, squares::e5)));
+}
+
+TEST_F(SeeTests, TestThat_See_LosesPieceForDefendedPawn)
+{
+    Position pos = fen::parse_fen("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1");
+    ASSERT_EQ(PAWN - KNIGHT, see(pos, find_move(pos, sides::white, squares::d3, squares::e5)));
+}
+
+TEST_F(SeeTests, TestThat_See_CountsXRayAttackers)
+{
+    // The second rook only joins in once the first has gone.
+    Position pos = fen::parse_fen("3rk3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1");
+    ASSERT_EQ(PAWN, see(pos, find_move(pos, sides::white, squares::d2, squares::d5)));
+
+    pos = fen::parse_fen("3rk3/8/8/3p4/8/8/3R4/4K3 w - - 0 1");
+    ASSERT_EQ(PAWN - ROOK, see(pos, find_move(pos, sides::white, squares::d2, squares::d5)));
+}
+
+TEST_F(SeeTests, TestThat_See_HandlesEnPassant)
+{
+    Position pos = fen::parse_fen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    ASSERT_EQ(PAWN, see(pos, find_move(pos, sides::white, squares::e5, squares::d6)));
+
+    pos = fen::parse_fen("4k3/2p5/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    ASSERT_EQ(0, see(pos, find_move(pos, sides::white, squares::e5, squares::d6)));
+
+    // Taking the pawn off d5 lets the queen behind it defend d6.
+    pos = fen::parse_fen("3rk3/8/8/3pP3/8/8/8/4K3 w - d6 0 1");
+    ASSERT_EQ(0, see(pos, find_move(pos, sides::white, squares::e5, squares::d6)));
+    pos = fen::parse_fen("3rk3/8/8/3pP3/8/8/8/3QK3 w - d6 0 1");
+    ASSERT_EQ(PAWN, see(pos, find_move(pos, sides::white, squares::e5, squares::d6)));
+}
+
+TEST_F(SeeTests, TestThat_See_HandlesPromotions)
+{
+    Position pos = fen::parse_fen("3r3k/2P5/8/8/8/8/8/K7 w - - 0 1");
+    ASSERT_EQ(ROOK + QUEEN - PAWN, see(pos, find_move(pos, sides::white, squares::c7, squares::d8, pieces::WHITE_QUEEN)));
+    ASSERT_EQ((QUEEN - PAWN) - QUEEN, see(pos, find_move(pos, sides::white, squares::c7, squares::c8, pieces::WHITE_QUEEN)));
+
+    // Recapturing with a pawn that promotes as it does so.
+    pos = fen::parse_fen("4k3/8/8/8/8/8/1p6/R3K3 w - - 0 1");
+    ASSERT_EQ(-(ROOK + QUEEN - PAWN), see(pos, find_move(pos, sides::white, squares::a1, squares::c1)));
+}
+
+TEST_F(SeeTests, TestThat_See_KingDoesNotCaptureDefendedPiece)
+{
+    Position pos = fen::parse_fen("4k3/8/8/8/8/2b5/3r4/3RK3 w - - 0 1");
+    ASSERT_EQ(ROOK - ROOK + BISHOP, see(pos, find_move(pos, sides::white, squares::d1, squares::d2)));
+
+    // The queen behind the bishop defends d2 once the bishop has taken.
+    pos = fen::parse_fen("4k3/8/8/q7/8/2b5/3r4/3RK3 w - - 0 1");
+    ASSERT_EQ(ROOK - ROOK, see(pos, find_move(pos, sides::white, squares::d1, squares::d2)));
+}
+
+TEST_F(SeeTests, TestThat_SeeGe_AgreesWithSee)
+{
+    const char *fens[] =
+    {
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq -",
+        "r1b2rk1/pp3ppp/2n5/3qN3/3P4/2PB4/P4PPP/R2QR1K1 b - - 0 1",
+        "n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1",
+        "1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1",
+    };
+    const PosEvaluation thresholds[] = { -QUEEN, -ROOK, -BISHOP, -PAWN, -1, 0, 1, PAWN, KNIGHT, ROOK, QUEEN };
+
+    for (auto fen : fens)
+    {
+        Side side_to_move;
+        Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+
+        MoveVector moves;
+        generate_all_moves(moves, pos, side_to_move);
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            PosEvaluation exchange = see(pos, moves[i]);
+            for (PosEvaluation threshold : thresholds)
+                ASSERT_EQ(exchange >= threshold, see_ge(pos, moves[i], threshold));
+        }
+    }
+}
+
+} //anonymous namespace
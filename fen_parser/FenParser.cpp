@@ -248,6 +248,8 @@ namespace chess { namespace fen
             *side_to_move = to_move;
 
         pos.update_sides();
+        // The castling rights and EP square were set directly, so the hash key needs working out afresh.
+        pos.recompute_incremental_evals();
 		return pos;
 	}
 }}
\ No newline at end of file
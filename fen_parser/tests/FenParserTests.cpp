@@ -111,6 +111,7 @@ TEST_F(FenParserTests, TestThat_ValidFenString_IsParsedCorrectly_ExampleMiddlega
 
     expected.fifty_move_count = 1;
     expected.castling_rights = sides::CASTLING_RIGHTS_ANY_BLACK | sides::CASTLING_RIGHTS_ANY_WHITE;
+    expected.recompute_incremental_evals(); // For the castling rights' part of the hash key
 
 	test_helper(fen, ParsingOK, expected);
 }
@@ -4,8 +4,12 @@
 #include <engine/BasicOperations.hpp>
 #include <engine/MoveGenerator.hpp>
 #include <engine/Evaluator.hpp>
+#include <engine/EvalTrace.hpp>
+#include <engine/Endgame.hpp>
 #include <engine/Search.hpp>
 #include <engine/Perft.hpp>
+#include <engine/EvalCache.hpp>
+#include <engine/Nnue.hpp>
 #include <fen_parser/FenParser.hpp>
 #include <display/PgnWriter.hpp>
 #include <display/ConsoleDisplay.hpp>
@@ -13,14 +17,29 @@
 #include <random>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <cstdio>
 #include <chrono>
+#include <vector>
 
 #define LOG_ERROR(message, ...) fprintf(stderr, "\n***ERROR*** " message "\n", ##__VA_ARGS__)
 
 using namespace chess;
 using namespace std;
 
+static void print_search_statistics(const SearchStatistics &stats)
+{
+    double pawn_hash_hit_rate  = stats.pawn_hash_probes  ? 100.0 * stats.pawn_hash_hits  / stats.pawn_hash_probes  : 0.0;
+    double eval_cache_hit_rate = stats.eval_cache_probes ? 100.0 * stats.eval_cache_hits / stats.eval_cache_probes : 0.0;
+
+    printf("Nodes: %" PRIu64 " (%" PRIu64 " quiescence), leaf evals: %" PRIu64 ", pawn hash: %" PRIu64 " probes, %.1f%% hits, eval cache: %" PRIu64 " probes, %.1f%% hits\n",
+           stats.nodes, stats.quiescence_nodes, stats.leaf_evals, stats.pawn_hash_probes, pawn_hash_hit_rate, stats.eval_cache_probes, eval_cache_hit_rate);
+    if (stats.eval_stages[EVAL_STAGE_MATERIAL] + stats.eval_stages[EVAL_STAGE_PAWNS] + stats.eval_stages[EVAL_STAGE_FULL])
+        printf("Classical evals: %" PRIu64 " lazy after material, %" PRIu64 " lazy after pawns, %" PRIu64 " in full\n",
+               stats.eval_stages[EVAL_STAGE_MATERIAL], stats.eval_stages[EVAL_STAGE_PAWNS], stats.eval_stages[EVAL_STAGE_FULL]);
+}
+
 static void play_self(const string &fen)
 {
     std::ofstream pgn_file("test_game.pgn", std::ios::out);
@@ -63,7 +82,9 @@ static void play_self(const string &fen)
 
     while (1)
     {
+        reset_search_statistics();
         MoveAndEval result        = alpha_beta(side, pos, DEPTH, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+        SearchStatistics stats    = get_search_statistics();
         MoveAndEval minimax_check = minimax(side, pos, DEPTH);
 
         if (result.best_eval != minimax_check.best_eval)
@@ -101,6 +122,7 @@ static void play_self(const string &fen)
         else
         {
             printf("\nMaterial: %+d, Fifty-move counter: %d\n", pos.material / 100, pos.fifty_move_count);
+            print_search_statistics(stats);
         }
 
         assert(pos.kings[0]);
@@ -163,6 +185,329 @@ static void perft_bench()
         perft_driver_nodesonly(pos, 6, side_to_move, 119060324, false);
 }
 
+// A few middlegame and endgame positions.
+static const char *const bench_fens[] =
+{
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP3PPP/R2QKB1R w KQ - 0 8",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+};
+
+// Fixed-depth searches of the bench positions, deepening one ply at a time as a real search would, with whichever evaluation
+// is currently selected.
+static void bench_positions(const char *title)
+{
+    const int BENCH_DEPTH = 5;
+
+    printf("\n%s\n", title);
+
+    uint64_t total_nodes = 0;
+    StopWatch total_watch;
+
+    for (auto fen : bench_fens)
+    {
+        Side side_to_move;
+        Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+
+        reset_search_statistics();
+        StopWatch watch;
+        MoveAndEval result;
+        for (int depth = 1; depth <= BENCH_DEPTH; ++depth)
+            result = alpha_beta(side_to_move, pos, depth, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
+
+        SearchStatistics stats = get_search_statistics();
+        total_nodes += stats.nodes;
+
+        printf("%s\nBest: %s (%d), %" PRId64 " ms. ", fen, move_to_coordtext(result.best_move).c_str(), result.best_eval, (int64_t)watch.elapsed_ms());
+        print_search_statistics(stats);
+    }
+
+    int64_t elapsed_ms = total_watch.elapsed_ms();
+    printf("Total: %" PRIu64 " nodes in %" PRId64 " ms, %" PRIu64 " nodes/second\n",
+           total_nodes, elapsed_ms, elapsed_ms ? (uint64_t)(1000 * total_nodes / elapsed_ms) : 0);
+}
+
+// Makes every move to the given depth, asking each position what attack-hungry code would: whether the side to move is in check,
+// and what each side attacks.
+static uint64_t attacks_walk(const Position &pos, Side side, int depth, uint64_t &checksum)
+{
+    checksum += pos.detect_check(side) + count_bits(pos.attacks_by(sides::white)) + count_bits(pos.attacks_by(sides::black));
+    if (depth == 0)
+        return 1;
+
+    MoveVector moves;
+    generate_all_moves(moves, pos, side);
+
+    uint64_t nodes = 1;
+    for (uint32_t i = 0; i < moves.size; ++i)
+    {
+        Position child(pos);
+        if (child.make_move(moves[i]))
+            nodes += attacks_walk(child, swap_side(side), depth - 1, checksum);
+    }
+    return nodes;
+}
+
+// What the attack queries cost along with making the moves, in this build: compare builds with and without
+// OINK_INCREMENTAL_ATTACKS.
+static void attacks_bench()
+{
+    const int DEPTH = 4;
+
+#ifdef OINK_INCREMENTAL_ATTACKS
+    printf("\nIncremental attack tables, Position is %zu bytes\n", sizeof(Position));
+#else
+    printf("\nAttacks worked out when asked for, Position is %zu bytes\n", sizeof(Position));
+#endif
+
+    uint64_t total_nodes = 0;
+    uint64_t checksum    = 0;
+    StopWatch watch;
+    for (auto fen : bench_fens)
+    {
+        Side side_to_move;
+        Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+        total_nodes += attacks_walk(pos, side_to_move, DEPTH, checksum);
+    }
+
+    int64_t elapsed_ms = watch.elapsed_ms();
+    printf("%" PRIu64 " nodes in %" PRId64 " ms, %" PRIu64 " nodes/second (checksum %" PRIu64 ")\n",
+           total_nodes, elapsed_ms, elapsed_ms ? (uint64_t)(1000 * total_nodes / elapsed_ms) : 0, checksum);
+}
+
+// What the eval cache is worth, and what each evaluation costs in nodes/second against plain material.
+static void search_bench()
+{
+    EvalCache &eval_cache = get_eval_cache();
+    const size_t cache_bytes = eval_cache.size_in_bytes();
+    const EvalType eval_type = get_eval_type();
+
+    set_eval_type(EVAL_MATERIAL);
+    bench_positions("Material eval");
+
+    set_eval_type(EVAL_CLASSICAL);
+    eval_cache.resize(0);
+    bench_positions("Classical eval, eval cache off");
+    eval_cache.resize(cache_bytes);
+    bench_positions("Classical eval, eval cache on");
+
+    if (nnue::network_loaded())
+    {
+        set_eval_type(EVAL_NNUE);
+        string title = string("NNUE eval (") + nnue::kernel_name() + ")";
+        bench_positions(title.c_str());
+    }
+    else
+        printf("\nNo NNUE network loaded: use nnue <file> or nnue_random\n");
+
+    set_eval_type(eval_type);
+}
+
+// What each group of terms adds to the classical evaluation of a position, from white's point of view.
+static void print_eval_trace(const string &fen)
+{
+    Position pos;
+    try
+    {
+        pos = fen::parse_fen(fen);
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR("Failed to parse FEN: %s", e.what());
+        return;
+    }
+
+    Score weights[eval_terms::NUM_TERMS];
+    get_eval_weights(weights);
+
+    EvalTrace trace;
+    PosEvaluation traced_eval = trace_evaluation(pos, trace);
+
+    Score groups[NUM_TERM_GROUPS];
+    get_term_group_scores(trace, weights, groups);
+
+    printf("\n%-20s %8s %8s %8s\n", "Term", "MG", "EG", "Tapered");
+    for (int group = 0; group < NUM_TERM_GROUPS; ++group)
+    {
+        // Material isn't tapered: its middlegame and endgame values are the same.
+        PosEvaluation tapered = group == TERMS_MATERIAL ? mg_value(groups[group]) : taper(groups[group], trace.phase);
+        printf("%-20s %8d %8d %8d\n", term_group_name(group), mg_value(groups[group]), eg_value(groups[group]), tapered);
+    }
+    printf("Phase %d of %d, total %d\n", trace.phase, evals::TOTAL_PHASE, traced_eval);
+
+    PosEvaluation eval = eval_position(sides::white, pos);
+
+    if (has_endgame_knowledge(pos))
+        printf("Endgame knowledge applies, which the breakdown leaves out: the evaluation is %d\n", eval);
+}
+
+// Positions one and two plies on from the bench positions, for a spread of material and pawn structures.
+static vector<Position> profile_positions()
+{
+    vector<Position> positions;
+    for (auto fen : bench_fens)
+    {
+        Side side_to_move;
+        Position pos = fen::parse_fen(fen, nullptr, &side_to_move);
+        positions.push_back(pos);
+
+        MoveVector moves;
+        generate_all_moves(moves, pos, side_to_move);
+        for (uint32_t i = 0; i < moves.size; ++i)
+        {
+            Position child = pos;
+            if (!child.make_move(moves[i]))
+                continue;
+            positions.push_back(child);
+
+            MoveVector replies;
+            generate_all_moves(replies, child, swap_side(side_to_move));
+            for (uint32_t j = 0; j < replies.size; ++j)
+            {
+                Position grandchild = child;
+                if (grandchild.make_move(replies[j]))
+                    positions.push_back(grandchild);
+            }
+        }
+    }
+    return positions;
+}
+
+// What the classical evaluation costs, part by part when built with OINK_EVAL_PROFILE, and what each group of terms is worth
+// on average, so that a term's cost in nodes/second can be weighed against what it adds.
+static void eval_profile()
+{
+    const int REPEATS = 100;
+
+    vector<Position> positions = profile_positions();
+
+    EvalCache &eval_cache = get_eval_cache();
+    const size_t cache_bytes = eval_cache.size_in_bytes();
+    const EvalType eval_type = get_eval_type();
+    set_eval_type(EVAL_CLASSICAL);
+    eval_cache.resize(0);
+
+    // Full windows, so that every part is done every time.
+    reset_eval_profile();
+    StopWatch watch;
+    PosEvaluation checksum = 0;
+    for (int repeat = 0; repeat < REPEATS; ++repeat)
+    {
+        for (auto &pos : positions)
+            checksum += eval_position(sides::white, pos);
+    }
+    int64_t elapsed_ms = watch.elapsed_ms();
+    EvalProfile profile = get_eval_profile();
+
+    eval_cache.resize(cache_bytes);
+    set_eval_type(eval_type);
+
+    uint64_t evals = (uint64_t)positions.size() * REPEATS;
+    printf("\n%" PRIu64 " evaluations of %zu positions in %" PRId64 " ms, %.0f ns each (checksum %d)\n",
+           evals, positions.size(), elapsed_ms, 1e6 * elapsed_ms / evals, checksum);
+
+    const char *part_names[NUM_PROFILE_PARTS] = { "Endgame", "Material", "Pawns", "Piece attacks", "Threats" };
+    if (profile.calls[PROFILE_MATERIAL] + profile.calls[PROFILE_ENDGAME])
+    {
+        printf("\n%-20s %10s %12s\n", "Part", "Calls", "Cycles/call");
+        for (int part = 0; part < NUM_PROFILE_PARTS; ++part)
+            printf("%-20s %10" PRIu64 " %12.1f\n", part_names[part], profile.calls[part],
+                   profile.calls[part] ? (double)profile.cycles[part] / profile.calls[part] : 0.0);
+    }
+    else
+        printf("Build with OINK_EVAL_PROFILE defined for the cost of each part\n");
+
+    // Terms that are rarely far from zero aren't worth much, however they're weighted.
+    Score weights[eval_terms::NUM_TERMS];
+    get_eval_weights(weights);
+
+    double average[NUM_TERM_GROUPS] = {};
+    int traced = 0;
+    for (auto &pos : positions)
+    {
+        if (has_endgame_knowledge(pos))
+            continue;
+
+        EvalTrace trace;
+        trace_evaluation(pos, trace);
+        Score groups[NUM_TERM_GROUPS];
+        get_term_group_scores(trace, weights, groups);
+        for (int group = 0; group < NUM_TERM_GROUPS; ++group)
+            average[group] += abs(group == TERMS_MATERIAL ? mg_value(groups[group]) : taper(groups[group], trace.phase));
+        ++traced;
+    }
+
+    printf("\n%-20s %10s\n", "Term", "Avg |eval|");
+    for (int group = 0; group < NUM_TERM_GROUPS; ++group)
+        printf("%-20s %10.1f\n", term_group_name(group), traced ? average[group] / traced : 0.0);
+}
+
+// How far the terms after each lazy evaluation exit move the evaluation, over the positions in an EPD file (the first four
+// fields of each line are read as a FEN, as by the tuner), to set evals::LAZY_MARGIN_MATERIAL and LAZY_MARGIN_PAWNS by.
+// Positions with endgame knowledge, which exits before either, are left out.
+static void lazy_margins(const string &path)
+{
+    ifstream file(path);
+    if (!file)
+    {
+        LOG_ERROR("Failed to open %s", path.c_str());
+        return;
+    }
+
+    Score weights[eval_terms::NUM_TERMS];
+    get_eval_weights(weights);
+
+    vector<PosEvaluation> after_material, after_pawns;
+    string line;
+    while (getline(file, line))
+    {
+        istringstream in(line);
+        string board, side, castling, en_passant;
+        in >> board >> side >> castling >> en_passant;
+
+        Position pos;
+        try
+        {
+            pos = fen::parse_fen(board + " " + side + " " + castling + " " + en_passant);
+        }
+        catch (const fen::FenParseFailure &)
+        {
+            continue;
+        }
+        if (has_endgame_knowledge(pos))
+            continue;
+
+        EvalTrace trace;
+        trace_evaluation(pos, trace);
+        Score groups[NUM_TERM_GROUPS];
+        get_term_group_scores(trace, weights, groups);
+
+        Score rest = groups[TERMS_MOBILITY] + groups[TERMS_THREATS] + groups[TERMS_KING_DANGER];
+        after_pawns.push_back(abs(taper(rest, trace.phase)));
+        rest += groups[TERMS_PAWN_STRUCTURE] + groups[TERMS_UNBLOCKED_PASSER] + groups[TERMS_PAWN_SHIELD];
+        after_material.push_back(abs(taper(rest, trace.phase)));
+    }
+
+    if (after_material.empty())
+    {
+        LOG_ERROR("No positions read from %s", path.c_str());
+        return;
+    }
+
+    printf("\n%zu positions. What the rest of the evaluation adds, by percentile:\n", after_material.size());
+    printf("%-16s %6s %6s %6s %6s %6s %6s\n", "After", "50%", "90%", "95%", "99%", "99.9%", "Max");
+    vector<PosEvaluation> *differences[] = { &after_material, &after_pawns };
+    const char *names[] = { "Material", "Pawns" };
+    for (int stage = 0; stage < 2; ++stage)
+    {
+        vector<PosEvaluation> &d = *differences[stage];
+        sort(d.begin(), d.end());
+        printf("%-16s %6d %6d %6d %6d %6d %6d\n", names[stage], d[d.size() / 2], d[d.size() * 9 / 10], d[d.size() * 95 / 100],
+               d[d.size() * 99 / 100], d[d.size() * 999 / 1000], d.back());
+    }
+}
+
 int main(int argc, char **argv)
 {
     constants_initialize();
@@ -178,6 +523,54 @@ int main(int argc, char **argv)
             perft_bench();
             cout << "\nDone\n" << endl;
         }
+        else if (input == "bench")
+        {
+            cout << "Running search benchmark..." << endl;
+            search_bench();
+            cout << "\nDone\n" << endl;
+        }
+        else if (input == "attacks_bench")
+        {
+            cout << "Running attacks benchmark..." << endl;
+            attacks_bench();
+            cout << "\nDone\n" << endl;
+        }
+        else if (input == "eval_trace")
+        {
+            string fen;
+            getline(cin >> ws, fen);
+            print_eval_trace(fen);
+        }
+        else if (input == "eval_profile")
+        {
+            cout << "Profiling the evaluation..." << endl;
+            eval_profile();
+            cout << "\nDone\n" << endl;
+        }
+        else if (input == "lazy_margins")
+        {
+            string path;
+            cin >> path;
+            lazy_margins(path);
+        }
+        else if (input == "nnue")
+        {
+            string path;
+            cin >> path;
+            if (nnue::load_network(path.c_str()))
+            {
+                set_eval_type(EVAL_NNUE);
+                cout << "Loaded NNUE network from " << path << ", using " << nnue::kernel_name() << " kernels" << endl;
+            }
+            else
+                LOG_ERROR("Failed to load NNUE network from %s", path.c_str());
+        }
+        else if (input == "nnue_random")
+        {
+            nnue::init_random_network(1);
+            set_eval_type(EVAL_NNUE);
+            cout << "Using a random NNUE network, with " << nnue::kernel_name() << " kernels" << endl;
+        }
         else if (input == "play_self") //"rnbqkbnr/pp1ppppp/8/2p5/8/2N5/PPPPPPPP/R1BQKBNR/"
         {
             cout << "Playing self..." << endl;
@@ -0,0 +1,589 @@
+// Texel-style tuning of the evaluation weights: finds the weights that best predict game results from a set of labelled
+// positions, where a position's predicted score is sigmoid(K * eval), and writes them out as engine/EvalWeights.hpp.
+//
+// The evaluation is linear in almost all of its weights, so each position is traced once up front (see EvalTrace.hpp) and
+// kept as a short list of (term, count) pairs. Evaluating with new weights is then just a dot product, and the whole
+// dataset can be gone through for each step of the gradient descent, on as many threads as there are cores.
+//
+// Usage: OinkTuner <dataset> [options]
+//   -o <file>        Where to write the weights (default EvalWeights.hpp)
+//   -i <iterations>  Gradient descent steps (default 2000)
+//   -r <rate>        Learning rate, roughly the most a weight can move in one step, in centipawns (default 1)
+//   -t <threads>     Default: one per core
+//   -n <positions>   Use only the first so many positions
+//   -k <K>           Scaling of eval to expected score, instead of fitting it to the data with the current weights
+//
+// The dataset is one position per line, a FEN (the rest of the line can be anything, e.g. EPD operations) and the game
+// result, either as "1-0", "0-1" or "1/2-1/2" (as in c9 "1-0";), or as [1.0], [0.5] or [0.0]. The positions should be quiet,
+// since the evaluation can't see captures about to happen.
+
+#include <engine/Position.hpp>
+#include <engine/Evaluator.hpp>
+#include <engine/EvalTrace.hpp>
+#include <engine/Endgame.hpp>
+#include <fen_parser/FenParser.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace chess;
+using namespace std;
+
+#define LOG_ERROR(message, ...) fprintf(stderr, "\n***ERROR*** " message "\n", ##__VA_ARGS__)
+
+struct TunerOptions
+{
+    string   dataset;
+    string   output       = "EvalWeights.hpp";
+    int      iterations   = 2000;
+    double   rate         = 1.0;
+    unsigned threads      = max(1u, thread::hardware_concurrency());
+    size_t   max_positions = SIZE_MAX;
+    double   k             = 0.0;  // Zero to fit it
+};
+
+// A traced position. Its coefficients are a run of the shared coefficient list.
+struct TunerEntry
+{
+    uint32_t first_coefficient;
+    uint16_t num_coefficients;
+    float    result;            // From white's point of view: 1 for a win, 0.5 for a draw
+    float    mg_factor;         // phase / TOTAL_PHASE
+    float    untuned_eval;      // Tapered, from white's point of view
+};
+
+struct TunerCoefficient
+{
+    uint16_t term;
+    int16_t  count;
+};
+
+struct TunerData
+{
+    vector<TunerEntry>       entries;
+    vector<TunerCoefficient> coefficients;
+};
+
+// Weights as they're tuned, which must be fractional for small steps to add up.
+struct TunerWeights
+{
+    double mg[eval_terms::NUM_TERMS];
+    double eg[eval_terms::NUM_TERMS];
+};
+
+static OINK_INLINE bool is_material_term(int term)
+{
+    return term < eval_terms::PSQ;
+}
+
+//==================================== Loading ====================================
+
+// -1 if there isn't one.
+static float parse_result(const string &line)
+{
+    if (line.find("1/2-1/2") != string::npos || line.find("[0.5]") != string::npos)
+        return 0.5f;
+    if (line.find("1-0") != string::npos || line.find("[1.0]") != string::npos || line.find("[1]") != string::npos)
+        return 1.0f;
+    if (line.find("0-1") != string::npos || line.find("[0.0]") != string::npos || line.find("[0]") != string::npos)
+        return 0.0f;
+    return -1.0f;
+}
+
+// The first four fields of the line; the move counters aren't needed.
+static string parse_fen_fields(const string &line)
+{
+    istringstream in(line);
+    string board, side, castling, en_passant;
+    in >> board >> side >> castling >> en_passant;
+    return board + " " + side + " " + castling + " " + en_passant;
+}
+
+static bool trace_line(const string &line, TunerData &data)
+{
+    float result = parse_result(line);
+    if (result < 0.0f)
+        return false;
+
+    Position pos;
+    try
+    {
+        pos = fen::parse_fen(parse_fen_fields(line));
+    }
+    catch (const fen::FenParseFailure &)
+    {
+        return false;
+    }
+
+    // Always a draw, so nothing to learn from; or evaluated by something other than the weights.
+    if (!(pos.whole_board & ~pos.kings[sides::white] & ~pos.kings[sides::black]) || has_endgame_knowledge(pos))
+        return false;
+
+    EvalTrace trace;
+    trace_evaluation(pos, trace);
+
+    TunerEntry entry;
+    entry.first_coefficient = (uint32_t)data.coefficients.size();
+    entry.num_coefficients  = 0;
+    entry.result            = result;
+    entry.mg_factor         = (float)trace.phase / evals::TOTAL_PHASE;
+    entry.untuned_eval      = (float)(mg_value(trace.untuned) * entry.mg_factor + eg_value(trace.untuned) * (1.0f - entry.mg_factor));
+
+    for (int term = 0; term < eval_terms::NUM_TERMS; ++term)
+    {
+        if (trace.coefficients[term])
+        {
+            data.coefficients.push_back({ (uint16_t)term, (int16_t)trace.coefficients[term] });
+            ++entry.num_coefficients;
+        }
+    }
+
+    data.entries.push_back(entry);
+    return true;
+}
+
+static bool load_dataset(const TunerOptions &options, TunerData &data)
+{
+    ifstream file(options.dataset);
+    if (!file)
+    {
+        LOG_ERROR("Failed to open %s", options.dataset.c_str());
+        return false;
+    }
+
+    vector<string> lines;
+    string line;
+    while (lines.size() < options.max_positions && getline(file, line))
+        lines.push_back(line);
+
+    // Each thread traces a slice of the lines into its own data, which are then joined up in order.
+    vector<TunerData> slices(options.threads);
+    vector<thread> workers;
+    for (unsigned t = 0; t < options.threads; ++t)
+    {
+        workers.emplace_back([&, t]()
+        {
+            size_t begin = lines.size() * t / options.threads;
+            size_t end   = lines.size() * (t + 1) / options.threads;
+            for (size_t i = begin; i < end; ++i)
+                trace_line(lines[i], slices[t]);
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    for (auto &slice : slices)
+    {
+        uint32_t offset = (uint32_t)data.coefficients.size();
+        for (auto entry : slice.entries)
+        {
+            entry.first_coefficient += offset;
+            data.entries.push_back(entry);
+        }
+        data.coefficients.insert(data.coefficients.end(), slice.coefficients.begin(), slice.coefficients.end());
+    }
+
+    printf("Loaded %zu positions (%zu lines skipped), %.1f terms per position\n",
+           data.entries.size(), lines.size() - data.entries.size(),
+           data.entries.empty() ? 0.0 : (double)data.coefficients.size() / data.entries.size());
+    return !data.entries.empty();
+}
+
+//=================================== Evaluation ===================================
+
+static OINK_INLINE double evaluate_entry(const TunerData &data, const TunerEntry &entry, const TunerWeights &weights)
+{
+    double mg = 0.0, eg = 0.0, material = 0.0;
+
+    const TunerCoefficient *coefficient = &data.coefficients[entry.first_coefficient];
+    for (int i = 0; i < entry.num_coefficients; ++i, ++coefficient)
+    {
+        if (is_material_term(coefficient->term))
+            material += coefficient->count * weights.mg[coefficient->term];
+        else
+        {
+            mg += coefficient->count * weights.mg[coefficient->term];
+            eg += coefficient->count * weights.eg[coefficient->term];
+        }
+    }
+
+    return material + mg * entry.mg_factor + eg * (1.0 - entry.mg_factor) + entry.untuned_eval;
+}
+
+// Expected score for white.
+static OINK_INLINE double sigmoid(double k, double eval)
+{
+    return 1.0 / (1.0 + pow(10.0, -k * eval / 400.0));
+}
+
+// Runs work(begin, end, thread index) over slices of the entries, one per thread.
+template<typename Work>
+static void parallel_for_entries(const TunerData &data, unsigned num_threads, Work work)
+{
+    vector<thread> workers;
+    size_t num_entries = data.entries.size();
+    for (unsigned t = 0; t < num_threads; ++t)
+        workers.emplace_back(work, num_entries * t / num_threads, num_entries * (t + 1) / num_threads, t);
+    for (auto &worker : workers)
+        worker.join();
+}
+
+// Mean squared error between results and expected scores.
+static double dataset_error(const TunerData &data, const TunerWeights &weights, double k, unsigned num_threads)
+{
+    vector<double> errors(num_threads, 0.0);
+    parallel_for_entries(data, num_threads, [&](size_t begin, size_t end, unsigned t)
+    {
+        double error = 0.0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const TunerEntry &entry = data.entries[i];
+            double difference = entry.result - sigmoid(k, evaluate_entry(data, entry, weights));
+            error += difference * difference;
+        }
+        errors[t] = error;
+    });
+
+    double total = 0.0;
+    for (double error : errors)
+        total += error;
+    return total / data.entries.size();
+}
+
+// The K that best fits the current weights to the results, so that tuning only has to change the weights where they're
+// out of line with each other, rather than to rescale them all.
+static double fit_k(const TunerData &data, const TunerWeights &weights, unsigned num_threads)
+{
+    // Golden section search; the error is smooth and has a single minimum over any sensible range.
+    const double ratio = (sqrt(5.0) - 1.0) / 2.0;
+    double low = 0.0, high = 4.0;
+    double x1 = high - ratio * (high - low), x2 = low + ratio * (high - low);
+    double e1 = dataset_error(data, weights, x1, num_threads), e2 = dataset_error(data, weights, x2, num_threads);
+
+    while (high - low > 0.0001)
+    {
+        if (e1 < e2)
+        {
+            high = x2; x2 = x1; e2 = e1;
+            x1 = high - ratio * (high - low);
+            e1 = dataset_error(data, weights, x1, num_threads);
+        }
+        else
+        {
+            low = x1; x1 = x2; e1 = e2;
+            x2 = low + ratio * (high - low);
+            e2 = dataset_error(data, weights, x2, num_threads);
+        }
+    }
+
+    return (low + high) / 2.0;
+}
+
+//==================================== Tuning ====================================
+
+// Gradient of the error with respect to every weight. Also returns the error, which comes for free.
+static double dataset_gradient(const TunerData &data, const TunerWeights &weights, double k, unsigned num_threads, TunerWeights &gradient)
+{
+    vector<TunerWeights> gradients(num_threads);
+    vector<double>       errors(num_threads, 0.0);
+
+    parallel_for_entries(data, num_threads, [&](size_t begin, size_t end, unsigned t)
+    {
+        TunerWeights &slice_gradient = gradients[t];
+        memset(&slice_gradient, 0, sizeof(slice_gradient));
+        double error = 0.0;
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            const TunerEntry &entry = data.entries[i];
+            double expected   = sigmoid(k, evaluate_entry(data, entry, weights));
+            double difference = entry.result - expected;
+            error += difference * difference;
+
+            // d(error)/d(eval), but for a constant factor, which is folded into the learning rate
+            double slope = -difference * expected * (1.0 - expected);
+
+            const TunerCoefficient *coefficient = &data.coefficients[entry.first_coefficient];
+            for (int c = 0; c < entry.num_coefficients; ++c, ++coefficient)
+            {
+                if (is_material_term(coefficient->term))
+                    slice_gradient.mg[coefficient->term] += slope * coefficient->count;
+                else
+                {
+                    slice_gradient.mg[coefficient->term] += slope * coefficient->count * entry.mg_factor;
+                    slice_gradient.eg[coefficient->term] += slope * coefficient->count * (1.0 - entry.mg_factor);
+                }
+            }
+        }
+
+        errors[t] = error;
+    });
+
+    memset(&gradient, 0, sizeof(gradient));
+    double error = 0.0;
+    for (unsigned t = 0; t < num_threads; ++t)
+    {
+        for (int term = 0; term < eval_terms::NUM_TERMS; ++term)
+        {
+            gradient.mg[term] += gradients[t].mg[term];
+            gradient.eg[term] += gradients[t].eg[term];
+        }
+        error += errors[t];
+    }
+    return error / data.entries.size();
+}
+
+// Adam: each weight's step is scaled by how big and how consistent its gradient has been, so that weights that are rarely
+// used (most of the piece-square entries) move as readily as those that are used in every position.
+struct AdamState
+{
+    TunerWeights momentum;
+    TunerWeights velocity;
+};
+
+static OINK_INLINE void adam_step(double &weight, double gradient, double &momentum, double &velocity, double rate, int iteration)
+{
+    const double beta1 = 0.9, beta2 = 0.999, epsilon = 1e-8;
+
+    momentum = beta1 * momentum + (1.0 - beta1) * gradient;
+    velocity = beta2 * velocity + (1.0 - beta2) * gradient * gradient;
+
+    double momentum_hat = momentum / (1.0 - pow(beta1, iteration));
+    double velocity_hat = velocity / (1.0 - pow(beta2, iteration));
+    weight -= rate * momentum_hat / (sqrt(velocity_hat) + epsilon);
+}
+
+static void update_weights(TunerWeights &weights, const TunerWeights &gradient, AdamState &adam, double rate, int iteration)
+{
+    for (int term = 0; term < eval_terms::NUM_TERMS; ++term)
+    {
+        adam_step(weights.mg[term], gradient.mg[term], adam.momentum.mg[term], adam.velocity.mg[term], rate, iteration);
+
+        // Piece values aren't tapered, so only have the one value.
+        if (is_material_term(term))
+            weights.eg[term] = weights.mg[term];
+        else
+            adam_step(weights.eg[term], gradient.eg[term], adam.momentum.eg[term], adam.velocity.eg[term], rate, iteration);
+    }
+}
+
+//==================================== Output ====================================
+
+static int round_weight(double weight)
+{
+    return (int)max(-32000.0, min(32000.0, floor(weight + 0.5)));
+}
+
+static string score_text(const TunerWeights &weights, int term)
+{
+    char text[40];
+    snprintf(text, sizeof(text), "make_score(%d, %d)", round_weight(weights.mg[term]), round_weight(weights.eg[term]));
+    return text;
+}
+
+static void write_score(FILE *file, const char *name, const TunerWeights &weights, int term)
+{
+    fprintf(file, "        const Score %-23s = %s;\n", name, score_text(weights, term).c_str());
+}
+
+static void write_score_array(FILE *file, const char *name, const TunerWeights &weights, int first_term, int num_terms)
+{
+    string array_name = string(name) + "[]";
+    if (num_terms <= 2)
+    {
+        fprintf(file, "        const Score %-23s = {", array_name.c_str());
+        for (int i = 0; i < num_terms; ++i)
+            fprintf(file, "%s %s", i ? "," : "", score_text(weights, first_term + i).c_str());
+        fprintf(file, " };\n");
+        return;
+    }
+
+    fprintf(file, "        const Score %s =\n        {\n", array_name.c_str());
+    for (int i = 0; i < num_terms; ++i)
+        fprintf(file, "%s%s,%s", i % 4 ? " " : "            ", score_text(weights, first_term + i).c_str(), i % 4 == 3 || i == num_terms - 1 ? "\n" : "");
+    fprintf(file, "        };\n");
+}
+
+static void write_psq_table(FILE *file, const char *name, const TunerWeights &weights, int type, bool endgame)
+{
+    fprintf(file, "        const PosEvaluation %s_%s[64] =\n        {\n", name, endgame ? "eg" : "mg");
+    for (int square = 0; square < util::NUM_SQUARES; ++square)
+    {
+        int term = eval_terms::PSQ + type * 64 + square;
+        fprintf(file, "%s%5d,%s", square % 8 ? "" : "           ", round_weight(endgame ? weights.eg[term] : weights.mg[term]),
+                square % 8 == 7 ? "\n" : "");
+    }
+    fprintf(file, "        };\n");
+}
+
+static bool write_weights(const char *path, const TunerWeights &weights, const string &provenance)
+{
+    using namespace eval_terms;
+
+    FILE *file = fopen(path, "w");
+    if (!file)
+    {
+        LOG_ERROR("Failed to open %s for writing", path);
+        return false;
+    }
+
+    // Indexed by piece type
+    const char *value_names[] = { "PAWN_VALUE", nullptr, "ROOK_VALUE", "KNIGHT_VALUE", "BISHOP_VALUE", "QUEEN_VALUE" };
+    const char *type_names[]  = { "pawn", "king", "rook", "knight", "bishop", "queen" };
+    const char *plurals[]     = { "Pawns", "Kings", "Rooks", "Knights", "Bishops", "Queens" };
+    const int   value_order[] = { 0, 3, 4, 2, 5 };
+    const int   table_order[] = { 0, 3, 4, 2, 5, 1 };
+
+    fprintf(file, "// Evaluation weights, written by the tuner (tuner/OinkTuner.cpp). See ChessConstants.hpp for what they mean.\n");
+    fprintf(file, "// %s\n", provenance.c_str());
+    fprintf(file, "#ifndef EVALWEIGHTS_HPP\n#define EVALWEIGHTS_HPP\n\n#include \"BasicTypes.hpp\"\n\nnamespace chess\n{\n    namespace evals\n    {\n");
+
+    for (int type : value_order)
+        fprintf(file, "        const PosEvaluation %-12s = %d;\n", value_names[type], round_weight(weights.mg[MATERIAL + type]));
+    fprintf(file, "\n");
+
+    write_score_array(file, "PASSED_PAWN_BONUS", weights, PASSED_PAWN, 8);
+    write_score_array(file, "CANDIDATE_PASSER_BONUS", weights, CANDIDATE_PASSER, 8);
+    fprintf(file, "\n");
+    write_score(file, "ISOLATED_PAWN_PENALTY",  weights, ISOLATED_PAWN);
+    write_score(file, "DOUBLED_PAWN_PENALTY",   weights, DOUBLED_PAWN);
+    write_score(file, "BACKWARD_PAWN_PENALTY",  weights, BACKWARD_PAWN);
+    write_score(file, "UNBLOCKED_PASSER_BONUS", weights, UNBLOCKED_PASSER);
+    write_score_array(file, "PAWN_SHIELD_BONUS", weights, PAWN_SHIELD, 2);
+    fprintf(file, "\n");
+
+    // Indexed by piece, so each weight appears twice, once per side.
+    fprintf(file, "        const Score MOBILITY_WEIGHTS[] =\n        {\n            0,\n");
+    for (int type = 0; type < 6; ++type)
+    {
+        if (type <= 1)
+            fprintf(file, "            0, 0, // %s\n", plurals[type]);
+        else
+        {
+            string text = score_text(weights, MOBILITY + type);
+            fprintf(file, "            %s, %s, // %s\n", text.c_str(), text.c_str(), plurals[type]);
+        }
+    }
+    fprintf(file, "        };\n\n");
+
+    write_score(file, "HANGING_PIECE_PENALTY",   weights, HANGING_PIECE);
+    write_score(file, "THREAT_BY_PAWN_PENALTY",  weights, THREAT_BY_PAWN);
+    write_score(file, "THREAT_BY_MINOR_PENALTY", weights, THREAT_BY_MINOR);
+    fprintf(file, "    }\n\n");
+
+    fprintf(file, "    // Piece-square tables for white. Unlike the move tables, these are laid out as you'd look at the board: a8 is top left,\n");
+    fprintf(file, "    // h1 bottom right. Indexing by (square ^ 56) flips them to a1-first.\n");
+    fprintf(file, "    namespace pst\n    {\n");
+    for (int i = 0; i < 6; ++i)
+    {
+        int type = table_order[i];
+        if (i)
+            fprintf(file, "\n");
+        write_psq_table(file, type_names[type], weights, type, false);
+        fprintf(file, "\n");
+        write_psq_table(file, type_names[type], weights, type, true);
+    }
+    fprintf(file, "    }\n}\n\n#endif // EVALWEIGHTS_HPP\n");
+
+    return fclose(file) == 0;
+}
+
+//===================================== Main =====================================
+
+static bool parse_options(int argc, char **argv, TunerOptions &options)
+{
+    if (argc < 2)
+        return false;
+
+    options.dataset = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        string option = argv[i];
+        const char *value = argv[i + 1];
+
+        if (option == "-o")
+            options.output = value;
+        else if (option == "-i")
+            options.iterations = atoi(value);
+        else if (option == "-r")
+            options.rate = atof(value);
+        else if (option == "-t")
+            options.threads = max(1, atoi(value));
+        else if (option == "-n")
+            options.max_positions = (size_t)atoll(value);
+        else if (option == "-k")
+            options.k = atof(value);
+        else
+            return false;
+    }
+    return (argc % 2) == 0;
+}
+
+int main(int argc, char **argv)
+{
+    TunerOptions options;
+    if (!parse_options(argc, argv, options))
+    {
+        printf("Usage: OinkTuner <dataset> [-o <output header>] [-i <iterations>] [-r <learning rate>] [-t <threads>] [-n <max positions>] [-k <K>]\n");
+        return 1;
+    }
+
+    constants_initialize();
+
+    auto start = chrono::steady_clock::now();
+    auto elapsed_seconds = [&]() { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    TunerData data;
+    if (!load_dataset(options, data))
+        return 1;
+    printf("Traced in %.1fs, using %u threads\n", elapsed_seconds(), options.threads);
+
+    Score engine_weights[eval_terms::NUM_TERMS];
+    get_eval_weights(engine_weights);
+
+    TunerWeights weights;
+    for (int term = 0; term < eval_terms::NUM_TERMS; ++term)
+    {
+        weights.mg[term] = mg_value(engine_weights[term]);
+        weights.eg[term] = eg_value(engine_weights[term]);
+    }
+
+    double k = options.k ? options.k : fit_k(data, weights, options.threads);
+    double error = dataset_error(data, weights, k, options.threads);
+    printf("K = %.4f, starting error %.6f\n", k, error);
+
+    AdamState adam;
+    memset(&adam, 0, sizeof(adam));
+    TunerWeights gradient;
+
+    for (int iteration = 1; iteration <= options.iterations; ++iteration)
+    {
+        error = dataset_gradient(data, weights, k, options.threads, gradient);
+        update_weights(weights, gradient, adam, options.rate, iteration);
+
+        if (iteration % 100 == 0)
+            printf("Iteration %d: error %.6f (%.1fs)\n", iteration, error, elapsed_seconds());
+    }
+
+    error = dataset_error(data, weights, k, options.threads);
+    printf("Final error %.6f, after %.1fs\n", error, elapsed_seconds());
+
+    char provenance[512];
+    snprintf(provenance, sizeof(provenance), "Tuned on %s: %zu positions, %d iterations, K = %.4f, error %.6f.",
+             options.dataset.c_str(), data.entries.size(), options.iterations, k, error);
+    if (!write_weights(options.output.c_str(), weights, provenance))
+        return 1;
+
+    printf("Weights written to %s\n", options.output.c_str());
+    return 0;
+}
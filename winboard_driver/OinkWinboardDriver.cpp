@@ -2,13 +2,17 @@
 // http://www.open-aurec.com/wbforum/viewtopic.php?f=24&t=51739
 
 #include <engine/Position.hpp>
+#include <engine/MoveGenerator.hpp>
 #include <engine/Search.hpp>
+#include <engine/Evaluator.hpp>
+#include <engine/EvalCache.hpp>
 #include <display/ConsoleDisplay.hpp>
 #include <fen_parser/FenParser.hpp>
 
 #include <cstdio>
 #include <string>
 #include <chrono>
+#include <algorithm>
 
 using namespace chess;
 using namespace std;
@@ -19,7 +23,15 @@ static const int MAX_SEARCH_DEPTH = 60;
 // If "megabytes" is different from last time, resize all tables to make memory usage below "megabytes"
 static void set_memory_size(int megabytes)
 {
-    return;
+    static int last_megabytes = -1;
+    if (megabytes == last_megabytes)
+        return;
+    last_megabytes = megabytes;
+
+    // The pawn hash is small and fixed in size. The eval cache is only worth having while it's small (see
+    // MAX_EVAL_CACHE_BYTES), so it only gets an eighth.
+    size_t bytes = (size_t)megabytes * 1024 * 1024;
+    get_eval_cache().resize(std::min(bytes / 8, MAX_EVAL_CACHE_BYTES));
 }        
 
 // Search current position for stm, deepening forever until there is input.
@@ -53,59 +65,6 @@ public:
     }
 };
 
-Move parse_move(const Position &pos, const string &move_str)
-{
-    RankFile source_file = move_str[0] - 'a';
-    RankFile source_rank = move_str[1] - '1';
-    RankFile dest_file   = move_str[2] - 'a';
-    RankFile dest_rank   = move_str[3] - '1';
-    Move move;
-    if (move_str.length() > 4)
-    {
-        Side side = (dest_rank == 0 ? sides::black : sides::white);
-
-        if (move_str[4] == 'b')
-            move.set_promotion_piece(pieces::BISHOPS[side]);
-        else if (move_str[4] == 'n')
-            move.set_promotion_piece(pieces::KNIGHTS[side]);
-        else if (move_str[4] == 'r')
-            move.set_promotion_piece(pieces::ROOKS[side]);
-        else if (move_str[4] == 'q')
-            move.set_promotion_piece(pieces::QUEENS[side]);
-    }
-    
-    Square source_sq = rank_file_to_square(source_rank, source_file);
-    Square dest_sq = rank_file_to_square(dest_rank, dest_file);
-    move.set_source(source_sq);
-    move.set_destination(dest_sq);
-    move.set_piece(pos.squares[source_sq]);
-    move.set_captured_piece(pos.squares[dest_sq]);
-
-    if ((move.get_piece() == pieces::WHITE_PAWN || move.get_piece() == pieces::BLACK_PAWN) &&
-        ((abs(source_sq - dest_sq) % 8) != 0) && (pos.squares[dest_sq] == pieces::NONE))
-    {
-        move.set_en_passant(pieces::PAWNS[get_piece_side(move.get_piece())]);
-    }
-    else if (move.get_piece() == pieces::WHITE_KING && (source_sq == squares::e1 && dest_sq == squares::g1))
-    {
-        move.set_castling(moves::CASTLING_WHITE_KINGSIDE);
-    }
-    else if (move.get_piece() == pieces::WHITE_KING && (source_sq == squares::e1 && dest_sq == squares::c1))
-    {
-        move.set_castling(moves::CASTLING_WHITE_QUEENSIDE);
-    }
-    else if (move.get_piece() == pieces::BLACK_KING && (source_sq == squares::e8 && dest_sq == squares::g8))
-    {
-        move.set_castling(moves::CASTLING_BLACK_KINGSIDE);
-    }
-    else if (move.get_piece() == pieces::BLACK_KING && (source_sq == squares::e8 && dest_sq == squares::c8))
-    {
-        move.set_castling(moves::CASTLING_BLACK_QUEENSIDE);
-    }
-
-    return move;
-}
-
 PosEvaluation search_best_move(const Position &pos, Side side_to_move, Move *move, Move *ponder_move)
 {
     MoveAndEval result = alpha_beta(side_to_move, pos, 6, -2*evals::MATE_SCORE, 2*evals::MATE_SCORE);
@@ -510,16 +469,15 @@ int main()
         
         if (!strcmp(command, "usermove"))
         {
-            Move move = parse_move(pos, input_buffer + 9);
+            // Only ever a legal move, as make_move leaves the position half-updated when it refuses one.
+            Move move = parse_coordinate_move(pos, side_to_move, input_buffer + 9);
             if (!move.data)
             {
-                printf("Invalid move string\n");
+                printf("Illegal move: %s", input_buffer + 9); // Still ends with the newline
             }
             else
             {
-                if (!pos.make_move(move))
-                    printf("Illegal move\n");
-
+                pos.make_move(move);
                 side_to_move = swap_side(side_to_move);
                 game_history[move_number++] = move;
             }